@@ -0,0 +1,133 @@
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "dump_generator.h"
+#include "type_registry.h"
+
+namespace bench {
+
+using namespace std::string_literals;
+
+namespace {
+// splitmix64, unlike the standard distributions its output is the same
+// with every standard library
+class Random {
+public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  uint64_t Below(uint64_t n) { return n ? Next() % n : 0; }
+  double Unit() { return static_cast<double>(Next() >> 11) * 0x1.0p-53; }
+
+private:
+  uint64_t state_;
+};
+
+constexpr size_t kKinds = 4;
+constexpr size_t kSuffixes = sft::kTypeRegistry.size() / kKinds;
+
+// Registered types of a value kind, BIT, BIT_EX, BIT_EX_B and so on.
+constexpr std::array<std::array<sft::TypeCode, kSuffixes>, kKinds>
+GetTypesByKind() {
+  std::array<std::array<sft::TypeCode, kSuffixes>, kKinds> result{};
+  std::array<size_t, kKinds> sizes{};
+  for (size_t i = 0; i != sft::kTypeRegistry.size(); ++i) {
+    size_t kind = static_cast<size_t>(sft::kTypeRegistry[i].kind_);
+    result[kind][sizes[kind]++] = static_cast<sft::TypeCode>(i);
+  }
+  return result;
+}
+
+constexpr auto kTypesByKind = GetTypesByKind();
+
+std::string GetValue(size_t kind, Random &random) {
+  switch (kind) {
+  case 0:
+    return std::to_string(random.Below(2));
+  case 1:
+    return std::to_string(random.Below(256));
+  case 2:
+    return std::to_string(static_cast<uint32_t>(random.Next()));
+  default:
+    return "value_"s + std::to_string(random.Below(1000000));
+  }
+}
+
+std::string ChangeValue(size_t kind, const std::string &value, Random &random) {
+  switch (kind) {
+  case 0:
+    return value == "0" ? "1"s : "0"s;
+  case 1:
+    return std::to_string(std::stoul(value) ^ (1 + random.Below(255)));
+  case 2:
+    return std::to_string(static_cast<uint32_t>(
+        std::stoul(value) ^ (1 + random.Below(0xfffffffeu))));
+  default:
+    return value + "_changed"s;
+  }
+}
+
+void AppendLine(std::string &out, sft::TypeCode code, uint64_t id,
+                const std::string &value) {
+  const sft::TypeDescriptor &type = sft::kTypeRegistry[code];
+  out.append("SET SOFTPARA: DT=").append(type.name_);
+  out.append(", ").append(type.number_field_).append("=");
+  out.append(std::to_string(id));
+  out.append(", ").append(type.value_field_).append("=\"");
+  out.append(value).append("\";\n");
+}
+} // namespace
+
+DumpPair GenerateDumps(const DumpOptions &options) {
+  Random random(options.seed_);
+  const uint32_t total = std::accumulate(options.type_mix_.begin(),
+                                         options.type_mix_.end(), 0u);
+  if (total == 0) {
+    throw std::invalid_argument("Empty type mix.");
+  }
+  std::array<uint64_t, sft::kTypeRegistry.size()> next_id{};
+
+  DumpPair result;
+  const size_t kLineSize = 56;
+  result.first_ = "SET SYS:NM=\"NE01\";\n";
+  result.second_ = "SET SYS:NM=\"NE02\";\n";
+  result.first_.reserve(options.params_ * kLineSize);
+  result.second_.reserve(options.params_ * kLineSize);
+
+  for (size_t i = 0; i != options.params_; ++i) {
+    size_t kind = 0;
+    for (uint64_t w = random.Below(total); w >= options.type_mix_[kind];) {
+      w -= options.type_mix_[kind++];
+    }
+    sft::TypeCode code = kTypesByKind[kind][random.Below(kSuffixes)];
+    uint64_t id = ++next_id[code];
+    std::string value = GetValue(kind, random);
+    AppendLine(result.first_, code, id, value);
+
+    if (random.Unit() >= options.difference_rate_) {
+      AppendLine(result.second_, code, id, value);
+    } else if (random.Below(10) != 0) {
+      AppendLine(result.second_, code, id, ChangeValue(kind, value, random));
+    }
+  }
+  return result;
+}
+
+std::string WriteDump(const std::string &name, const std::string &text) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(text.data(), text.size());
+  return path.string();
+}
+
+} // namespace bench
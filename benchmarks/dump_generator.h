@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bench {
+
+struct DumpOptions {
+  size_t params_ = 10000;
+  uint64_t seed_ = 1;
+  // relative weights of BIT, BYTE, DWORD and STRING parameters
+  std::array<uint32_t, 4> type_mix_ = {4, 3, 2, 1};
+  // share of keys whose value differs in the second dump; a tenth of them
+  // are missing there instead
+  double difference_rate_ = 0.01;
+};
+
+// Two dumps of the same NE type, the second one derived from the first.
+struct DumpPair {
+  std::string first_;
+  std::string second_;
+};
+
+// Same options and seed give the same dumps on every platform.
+DumpPair GenerateDumps(const DumpOptions &options);
+
+// Writes text to a file in the temporary directory and returns its path.
+std::string WriteDump(const std::string &name, const std::string &text);
+
+} // namespace bench
@@ -0,0 +1,220 @@
+#include <array>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include <benchmark/benchmark.h>
+
+#include "dump_generator.h"
+#include "mml_utils.h"
+#include "param_compare.h"
+#include "param_fabric.h"
+#include "params.h"
+#include "report.h"
+#include "table_report.h"
+#include "type_registry.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::string kPrefix = "SET SOFTPARA:"s;
+
+// Generated dumps and the results of every stage, built once per size so
+// that each benchmark times only its own stage.
+struct Fixture {
+  std::array<std::string, 2> files_;
+  std::unique_ptr<mml::LoadedFile> loaded_;
+  std::unique_ptr<mml::VectorRecordView> records_;
+  sft::VectorParameterInfo unsorted_;
+  std::array<sft::VectorParameterInfo, 2> sorted_;
+  std::array<sft::TableFingerprint, 2> fingerprints_;
+  sft::VectorParameterPair pairs_;
+  sft::VectorDifferenceRecord differences_;
+};
+
+const Fixture &GetFixture(size_t params) {
+  static std::map<size_t, std::unique_ptr<Fixture>> fixtures;
+  auto &fixture = fixtures[params];
+  if (fixture) {
+    return *fixture;
+  }
+
+  fixture = std::make_unique<Fixture>();
+  bench::DumpOptions options;
+  options.params_ = params;
+  bench::DumpPair dumps = bench::GenerateDumps(options);
+  auto name = "bench_"s + std::to_string(params);
+  fixture->files_ = {bench::WriteDump(name + "_1.txt", dumps.first_),
+                     bench::WriteDump(name + "_2.txt", dumps.second_)};
+
+  const mml::ConvertInfo ci = sft::GetConvertInfo("DT"s);
+  fixture->loaded_ =
+      std::make_unique<mml::LoadedFile>(fixture->files_[0], kPrefix);
+  fixture->records_ = std::make_unique<mml::VectorRecordView>(
+      fixture->loaded_->GetRecords(kPrefix));
+  fixture->unsorted_ = sft::Convert(*fixture->records_, ci);
+  for (size_t i = 0; i != 2; ++i) {
+    fixture->sorted_[i] = sft::Load(fixture->files_[i], kPrefix, ci);
+    fixture->fingerprints_[i] = sft::SortTable(fixture->sorted_[i]);
+  }
+  fixture->pairs_ = sft::GetDifferentParameters(
+      fixture->sorted_[0], fixture->fingerprints_[0], fixture->sorted_[1],
+      fixture->fingerprints_[1]);
+  fixture->differences_ =
+      sft::MakeDifferences(fixture->pairs_, sft::FindValueKind);
+  return *fixture;
+}
+
+// Discards the report, only the rendering is timed.
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char *, std::streamsize n) override {
+    return n;
+  }
+};
+
+void SizeArgs(benchmark::internal::Benchmark *b) {
+  b->Arg(10'000)->Arg(1'000'000)->Arg(10'000'000);
+  b->Unit(benchmark::kMillisecond);
+}
+
+void BM_MmlLoad(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    auto result = mml::Load(fixture.files_[0], kPrefix);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MmlLoad)->Apply(SizeArgs);
+
+void BM_LoadedFileRecords(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    mml::LoadedFile file(fixture.files_[0], kPrefix);
+    auto records = file.GetRecords(kPrefix);
+    benchmark::DoNotOptimize(records.data_.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadedFileRecords)->Apply(SizeArgs);
+
+void BM_Convert(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  const mml::ConvertInfo ci = sft::GetConvertInfo("DT"s);
+  for (auto _ : state) {
+    auto result = sft::Convert(*fixture.records_, ci);
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Convert)->Apply(SizeArgs);
+
+void BM_SortTable(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    sft::VectorParameterInfo table = fixture.unsorted_;
+    state.ResumeTiming();
+    auto fingerprint = sft::SortTable(table);
+    benchmark::DoNotOptimize(fingerprint);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortTable)->Apply(SizeArgs);
+
+void BM_CreateCommonIndex(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    auto index =
+        sft::CreateCommonIndex(fixture.sorted_[0], fixture.sorted_[1]);
+    benchmark::DoNotOptimize(index);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CreateCommonIndex)->Apply(SizeArgs);
+
+void BM_GetDifferentParameters(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    auto pairs = sft::GetDifferentParameters(
+        fixture.sorted_[0], fixture.fingerprints_[0], fixture.sorted_[1],
+        fixture.fingerprints_[1]);
+    benchmark::DoNotOptimize(pairs);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetDifferentParameters)->Apply(SizeArgs);
+
+void BM_MakeDifferences(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  for (auto _ : state) {
+    auto records = sft::MakeDifferences(fixture.pairs_, sft::FindValueKind);
+    benchmark::DoNotOptimize(records);
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.pairs_.size());
+}
+BENCHMARK(BM_MakeDifferences)->Apply(SizeArgs);
+
+// The difference fabric with one heap object per difference.
+void BM_FabricDifference(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  const sft::FabricDifferenceMap &fabric = sft::GetFabricDifferenceMap();
+  for (auto _ : state) {
+    for (const auto &pair : fixture.pairs_) {
+      const sft::ParameterInfo &info = pair.GetInfo();
+      sft::DifferenceInfo di{info.type_, info.id_,
+                             pair.left_ ? pair.left_->value_ : ""s,
+                             pair.right_ ? pair.right_->value_ : ""s};
+      auto difference = sft::FabricDifference(fabric, di);
+      benchmark::DoNotOptimize(difference->GetDetailsView().data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.pairs_.size());
+}
+BENCHMARK(BM_FabricDifference)->Apply(SizeArgs);
+
+// The table report of the tool, rows and details of every difference.
+void BM_RenderTable(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  const sft::TableInfo table_info = sft::PrepareTableInfo();
+  NullBuffer null_buffer;
+  std::ostream null_stream(&null_buffer);
+  for (auto _ : state) {
+    sft::BufferedWriter writer(null_stream);
+    sft::TableSink sink(writer, table_info);
+    sink.BeginPair("NE01", "NE02");
+    for (const auto &record : fixture.differences_) {
+      sink.Add(record);
+    }
+    sink.EndPair();
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.differences_.size());
+}
+BENCHMARK(BM_RenderTable)->Apply(SizeArgs);
+
+void BM_NdjsonSink(benchmark::State &state) {
+  const Fixture &fixture = GetFixture(state.range(0));
+  NullBuffer null_buffer;
+  std::ostream null_stream(&null_buffer);
+  for (auto _ : state) {
+    sft::BufferedWriter writer(null_stream);
+    sft::NdjsonSink sink(writer);
+    sink.BeginPair("NE01", "NE02");
+    for (const auto &record : fixture.differences_) {
+      sink.Add(record);
+    }
+    sink.EndPair();
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.differences_.size());
+}
+BENCHMARK(BM_NdjsonSink)->Apply(SizeArgs);
+
+} // namespace
+
+BENCHMARK_MAIN();
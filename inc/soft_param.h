@@ -1,25 +1,64 @@
 #pragma once
 
-#include "tabulator.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "external_sort.h"
+#include "incremental_table.h"
+#include "mml_utils.h"
+#include "param_compare.h"
+#include "report.h"
+#include "stats.h"
+#include "table_report.h"
 
 namespace my {
-struct TableInfo {
+struct SortedParams {
+  sft::VectorParameterInfo data_;
+  std::string ne_;
+  sft::TableFingerprint fingerprint_;
+};
 
-  tab::TableSchema desc_;
-  std::string top_line_;
-  std::string header_line_;
-  std::string sep_line_;
-  std::string footer_line_;
+// Table of a file in watch mode, updated from the changed lines.
+struct WatchedParams {
+  sft::IncrementalTable table_;
+  std::string ne_;
 };
 
-struct ComparsionResults {
-  std::array<std::unique_ptr<sft::SoftParameter>, 2> param_;
-  std::unique_ptr<sft::IDifference> diff_ = nullptr;
-  std::array<std::string, 2> ne;
+struct StreamedParams {
+  std::unique_ptr<sft::ExternalSorter> sorter_;
+  std::string ne_;
 };
 
-struct SortedParams {
-  sft::VectorParameterInfo data_;
+// Read-only state shared by every comparison of one run.
+struct CompareSettings {
+  std::string prefix_;
+  std::string sys_prefix_;
+  std::string ne_name_field_;
+  mml::ConvertInfo ci_;
+  sft::TableInfo table_info_;
+  // snapshots of parsed tables are kept here when not empty
+  std::string cache_dir_;
+  uint64_t settings_key_ = 0;
+  sft::ReportFormat format_ = sft::ReportFormat::Table;
+  // stage times and counters are added here when not null
+  util::Stats *stats_ = nullptr;
+};
+
+enum class StatsMode { Off, Text, Json };
+
+struct Options {
+  std::vector<std::string> files_;
+  std::string baseline_;
+  size_t threads_ = 0;
+  size_t memory_budget_ = 0;
+  std::string cache_dir_;
+  sft::ReportFormat format_ = sft::ReportFormat::Table;
+  StatsMode stats_ = StatsMode::Off;
+  bool watch_ = false;
+  // socket of the comparison server, files_ are its baselines then
+  std::string serve_;
 };
 
 } // namespace my
\ No newline at end of file
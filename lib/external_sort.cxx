@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "external_sort.h"
+
+namespace sft {
+
+namespace {
+
+void WriteBytes(std::FILE *file, const void *data, size_t size) {
+  if (size && std::fwrite(data, 1, size, file) != size) {
+    throw std::runtime_error("Can't write a temporary run file.");
+  }
+}
+
+bool ReadBytes(std::FILE *file, void *data, size_t size) {
+  return !size || std::fread(data, 1, size, file) == size;
+}
+
+void WriteString(std::FILE *file, const std::string &s) {
+  uint32_t size = static_cast<uint32_t>(s.size());
+  WriteBytes(file, &size, sizeof(size));
+  WriteBytes(file, s.data(), s.size());
+}
+
+bool ReadString(std::FILE *file, std::string &s) {
+  uint32_t size = 0;
+  if (!ReadBytes(file, &size, sizeof(size))) {
+    return false;
+  }
+  s.resize(size);
+  return ReadBytes(file, s.data(), size);
+}
+
+void WriteParameter(std::FILE *file, const ParameterInfo &info) {
+  WriteString(file, info.type_);
+  WriteBytes(file, &info.id_, sizeof(info.id_));
+  WriteString(file, info.value_);
+}
+
+bool ReadParameter(std::FILE *file, ParameterInfo &info) {
+  return ReadString(file, info.type_) &&
+         ReadBytes(file, &info.id_, sizeof(info.id_)) &&
+         ReadString(file, info.value_);
+}
+
+size_t GetFootprint(const ParameterInfo &info) {
+  return sizeof(ParameterInfo) + info.type_.size() + info.value_.size();
+}
+
+std::FILE *CreateRunFile() {
+  std::FILE *file = std::tmpfile();
+  if (!file) {
+    throw std::runtime_error("Can't create a temporary run file.");
+  }
+  return file;
+}
+
+} // namespace
+
+ExternalSorter::Run::~Run() {
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+ExternalSorter::ExternalSorter(size_t memory_budget, size_t merge_width,
+                               KeyOrder order)
+    : budget_(memory_budget), merge_width_(std::max<size_t>(merge_width, 2)),
+      order_(order) {}
+
+void ExternalSorter::SortBuffer() {
+  std::ranges::stable_sort(
+      buffer_, [this](const ParameterInfo &a, const ParameterInfo &b) {
+        return order_(a, b) < 0;
+      });
+}
+
+ExternalSorter::~ExternalSorter() = default;
+
+void ExternalSorter::Add(ParameterInfo info) {
+  used_ += GetFootprint(info);
+  buffer_.emplace_back(std::move(info));
+  if (used_ > budget_) {
+    Spill();
+  }
+}
+
+void ExternalSorter::Spill() {
+  SortBuffer();
+
+  auto run = std::make_unique<Run>();
+  run->file_ = CreateRunFile();
+  for (const auto &info : buffer_) {
+    WriteParameter(run->file_, info);
+  }
+  runs_.emplace_back(std::move(run));
+
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  used_ = 0;
+
+  // levels only decrease along runs_, so the runs of the last level are at
+  // the end and are merged in order
+  while (runs_.size() >= merge_width_ &&
+         runs_[runs_.size() - merge_width_]->level_ == runs_.back()->level_) {
+    MergeTail(merge_width_);
+  }
+}
+
+void ExternalSorter::MergeTail(size_t count) {
+  const size_t first = runs_.size() - count;
+  auto merged = std::make_unique<Run>();
+  merged->file_ = CreateRunFile();
+  merged->level_ = runs_[first]->level_ + 1;
+
+  StartMerge(first);
+  for (ParameterInfo info; PopMerged(info);) {
+    WriteParameter(merged->file_, info);
+  }
+  runs_.resize(first);
+  runs_.emplace_back(std::move(merged));
+}
+
+void ExternalSorter::StartMerge(size_t first) {
+  heap_.clear();
+  auto less = [this](size_t a, size_t b) { return HeapLess(a, b); };
+  for (size_t i = first, is = runs_.size(); i != is; ++i) {
+    std::rewind(runs_[i]->file_);
+    if (ReadParameter(runs_[i]->file_, runs_[i]->current_)) {
+      heap_.emplace_back(i);
+      std::ranges::push_heap(heap_, less);
+    }
+  }
+}
+
+bool ExternalSorter::PopMerged(ParameterInfo &info) {
+  if (heap_.empty()) {
+    return false;
+  }
+  auto less = [this](size_t a, size_t b) { return HeapLess(a, b); };
+  std::ranges::pop_heap(heap_, less);
+  Run &run = *runs_[heap_.back()];
+  info = std::move(run.current_);
+  if (ReadParameter(run.file_, run.current_)) {
+    std::ranges::push_heap(heap_, less);
+  } else {
+    heap_.pop_back();
+  }
+  return true;
+}
+
+// Min-heap order: smaller key first, the earlier run for equal keys.
+bool ExternalSorter::HeapLess(size_t a, size_t b) const {
+  int order = order_(runs_[a]->current_, runs_[b]->current_);
+  return order != 0 ? order > 0 : a > b;
+}
+
+void ExternalSorter::Finish() {
+  if (runs_.empty()) {
+    SortBuffer();
+    return;
+  }
+  if (!buffer_.empty()) {
+    Spill();
+  }
+  while (runs_.size() > merge_width_) {
+    MergeTail(merge_width_);
+  }
+  StartMerge(0);
+}
+
+bool ExternalSorter::Next(ParameterInfo &info) {
+  if (runs_.empty()) {
+    if (buffer_pos_ == buffer_.size()) {
+      return false;
+    }
+    info = std::move(buffer_[buffer_pos_++]);
+    return true;
+  }
+  return PopMerged(info);
+}
+
+} // namespace sft
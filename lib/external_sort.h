@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "param_compare.h"
+#include "params.h"
+
+namespace sft {
+
+// Sorts parameters by order, (type_, id_) by default, within a memory
+// budget. Records stay in memory until the budget is exceeded, then sorted
+// runs are spilled to temporary files and k-way merged while they are read
+// back. Records with equal keys keep the order in which they were added.
+// At most merge_width runs are merged at once: as soon as there are
+// merge_width runs of one size they are merged into one larger run, so the
+// number of open files grows with the logarithm of the input size.
+class ExternalSorter {
+public:
+  static constexpr size_t kMergeWidth = 64;
+
+  explicit ExternalSorter(size_t memory_budget,
+                          size_t merge_width = kMergeWidth,
+                          KeyOrder order = CompareKeys);
+  ~ExternalSorter();
+
+  ExternalSorter(const ExternalSorter &) = delete;
+  ExternalSorter &operator=(const ExternalSorter &) = delete;
+
+  void Add(ParameterInfo info);
+  // Ends the input, Next() returns the records in sorted order afterwards.
+  void Finish();
+  bool Next(ParameterInfo &info);
+
+  // Runs on disk, the ones left after the intermediate merges.
+  size_t GetRunCount() const { return runs_.size(); }
+  KeyOrder GetOrder() const { return order_; }
+
+private:
+  struct Run {
+    Run() = default;
+    Run(const Run &) = delete;
+    Run &operator=(const Run &) = delete;
+    ~Run();
+
+    std::FILE *file_ = nullptr;
+    // number of merges the records of the run went through
+    size_t level_ = 0;
+    ParameterInfo current_;
+  };
+
+  void SortBuffer();
+  void Spill();
+  // Replaces the last count runs by one run with their merged records.
+  void MergeTail(size_t count);
+  // Starts the k-way merge of the runs from first on.
+  void StartMerge(size_t first);
+  bool PopMerged(ParameterInfo &info);
+  bool HeapLess(size_t a, size_t b) const;
+
+  size_t budget_ = 0;
+  size_t merge_width_ = kMergeWidth;
+  KeyOrder order_ = CompareKeys;
+  size_t used_ = 0;
+  VectorParameterInfo buffer_;
+  size_t buffer_pos_ = 0;
+  std::vector<std::unique_ptr<Run>> runs_;
+  std::vector<size_t> heap_;
+};
+
+// Same contract as MergeJoin on vectors, for two streams sorted in the
+// order of s1. The pointers passed to f are valid only during the call, so
+// only the current record of each stream is kept in memory.
+template <typename F>
+void MergeJoin(ExternalSorter &s1, ExternalSorter &s2, F &&f) {
+  const KeyOrder compare = s1.GetOrder();
+  ParameterInfo cur1, cur2, next;
+  auto advance = [&next, compare](ExternalSorter &s, ParameterInfo &cur) {
+    while (s.Next(next)) {
+      if (compare(cur, next) != 0) {
+        std::swap(cur, next);
+        return true;
+      }
+    }
+    return false;
+  };
+
+  bool has1 = s1.Next(cur1);
+  bool has2 = s2.Next(cur2);
+  while (has1 || has2) {
+    int order = !has1 ? 1 : !has2 ? -1 : compare(cur1, cur2);
+    if (order < 0) {
+      f(ParameterPair{&cur1, nullptr});
+      has1 = advance(s1, cur1);
+    } else if (order > 0) {
+      f(ParameterPair{nullptr, &cur2});
+      has2 = advance(s2, cur2);
+    } else {
+      if (cur1.value_ != cur2.value_) {
+        f(ParameterPair{&cur1, &cur2});
+      }
+      has1 = advance(s1, cur1);
+      has2 = advance(s2, cur2);
+    }
+  }
+}
+
+} // namespace sft
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define UTIL_USE_INOTIFY 1
+#endif
+
+#include "file_watcher.h"
+
+namespace util {
+
+using namespace std::string_literals;
+
+#ifdef UTIL_USE_INOTIFY
+FileWatcher::FileWatcher(const std::vector<std::string> &files) {
+  fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::runtime_error("Can't start inotify."s);
+  }
+  for (const auto &file : files) {
+    std::filesystem::path path = std::filesystem::absolute(file);
+    std::string dir = path.parent_path().string();
+    int watch = ::inotify_add_watch(
+        fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+    if (watch < 0) {
+      ::close(fd_);
+      throw std::runtime_error("Can't watch directory '"s + dir + "'."s);
+    }
+    // a directory watched twice gets the same descriptor
+    files_.push_back({watch, path.filename().string()});
+  }
+}
+
+FileWatcher::~FileWatcher() { ::close(fd_); }
+
+void FileWatcher::ReadEvents(std::vector<size_t> &changed) {
+  alignas(inotify_event) char buffer[4096];
+  for (;;) {
+    ssize_t size = ::read(fd_, buffer, sizeof(buffer));
+    if (size <= 0) {
+      return;
+    }
+    for (ssize_t pos = 0; pos < size;) {
+      const auto *event = reinterpret_cast<const inotify_event *>(buffer + pos);
+      pos += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      std::string_view name(event->name);
+      for (size_t i = 0, is = files_.size(); i != is; ++i) {
+        if (files_[i].watch_ == event->wd && files_[i].name_ == name &&
+            std::ranges::find(changed, i) == changed.end()) {
+          changed.emplace_back(i);
+        }
+      }
+    }
+  }
+}
+
+std::vector<size_t> FileWatcher::Wait(std::chrono::milliseconds settle) {
+  std::vector<size_t> changed;
+  pollfd poll_fd{fd_, POLLIN, 0};
+  while (changed.empty()) {
+    if (::poll(&poll_fd, 1, -1) < 0) {
+      if (errno == EINTR) {
+        return changed;
+      }
+      throw std::runtime_error("Can't wait for inotify events."s);
+    }
+    ReadEvents(changed);
+  }
+
+  // a file is usually written in several steps, wait until it is quiet
+  int result;
+  while ((result = ::poll(&poll_fd, 1, static_cast<int>(settle.count()))) >
+         0) {
+    ReadEvents(changed);
+  }
+  if (result < 0 && errno == EINTR) {
+    return {};
+  }
+  std::ranges::sort(changed);
+  return changed;
+}
+#else
+FileWatcher::FileWatcher(const std::vector<std::string> &) {
+  throw std::runtime_error("Watching files needs inotify."s);
+}
+
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::ReadEvents(std::vector<size_t> &) {}
+
+std::vector<size_t> FileWatcher::Wait(std::chrono::milliseconds) {
+  return {};
+}
+#endif
+
+} // namespace util
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// Reports writes to a set of files with inotify. The directories of the
+// files are watched, so files replaced by a rename are noticed as well.
+class FileWatcher {
+public:
+  explicit FileWatcher(const std::vector<std::string> &files);
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  // Blocks until at least one file changes and no event came for settle.
+  // Returns the sorted indexes of the changed files, or nothing when the
+  // wait was interrupted by a signal.
+  std::vector<size_t> Wait(std::chrono::milliseconds settle);
+
+private:
+  // Reads the pending events and adds the changed files to changed.
+  void ReadEvents(std::vector<size_t> &changed);
+
+  struct WatchedFile {
+    int watch_ = -1;
+    std::string name_;
+  };
+
+  int fd_ = -1;
+  std::vector<WatchedFile> files_;
+};
+
+} // namespace util
@@ -70,4 +70,15 @@ std::string format_right(std::string_view sv, size_t width, char fill_error) {
   return result;
 }
 
+char *format_bits(char *first, uint32_t n, size_t bits, size_t group,
+                  char sep) {
+  for (size_t i = bits; i-- > 0;) {
+    *first++ = (n >> i) & 1u ? '1' : '0';
+    if (group && i && i % group == 0) {
+      *first++ = sep;
+    }
+  }
+  return first;
+}
+
 } // namespace fmt
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -14,4 +15,10 @@ std::string format_left(std::string_view sv, size_t width = 0,
 std::string format_right(std::string_view sv, size_t width = 0,
                          char fill_error = kSharp);
 
+// Writes the low bits of n in binary to first, grouped by group digits from the
+// right like insert_spaces(std::bitset<bits>(n).to_string(), group).
+// Returns the end of the written text, at most 64 characters are written.
+char *format_bits(char *first, uint32_t n, size_t bits, size_t group,
+                  char sep = kSpace);
+
 } // namespace fmt
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace util {
+
+constexpr uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+
+constexpr uint64_t Mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+constexpr uint64_t HashCombine(uint64_t h, uint64_t value) {
+  return Mix64(h ^ (value + kHashSeed + (h << 6) + (h >> 2)));
+}
+
+// Non-cryptographic 64-bit hash that reads eight bytes per step.
+inline uint64_t Hash64(std::string_view data, uint64_t seed = kHashSeed) {
+  const uint64_t kMul = 0x87c37b91114253d5ull;
+  uint64_t h = seed ^ (data.size() * kMul);
+  const char *p = data.data();
+  size_t n = data.size();
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t k;
+    std::memcpy(&k, p, 8);
+    h = (h ^ Mix64(k)) * kMul;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, p, n);
+  return Mix64(h ^ Mix64(tail ^ n));
+}
+
+} // namespace util
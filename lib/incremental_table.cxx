@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hash_util.h"
+#include "incremental_table.h"
+
+namespace sft {
+
+namespace {
+// A line of the new version, lines with equal text get the same hash.
+struct LinePos {
+  uint64_t hash_ = 0;
+  size_t line_ = 0;
+};
+
+// A key that may have changed and its parameter in the new version.
+struct Candidate {
+  std::optional<ParameterInfo> info_;
+  size_t lines_ = 0;
+};
+
+// New value of a key, or its removal when erase_ is set.
+struct Patch {
+  ParameterInfo info_;
+  bool erase_ = false;
+};
+
+// Merges patches sorted by key into the sorted table.
+VectorParameterInfo ApplyPatches(VectorParameterInfo &data,
+                                 std::vector<Patch> &patches) {
+  VectorParameterInfo result;
+  result.reserve(data.size() + patches.size());
+  auto it = data.begin(), end = data.end();
+  auto patch = patches.begin(), patch_end = patches.end();
+  while (it != end || patch != patch_end) {
+    int order = it == end           ? 1
+                : patch == patch_end ? -1
+                                     : CompareKeys(*it, patch->info_);
+    if (order < 0) {
+      result.emplace_back(std::move(*it++));
+      continue;
+    }
+    if (order == 0) {
+      ++it;
+    }
+    if (!patch->erase_) {
+      result.emplace_back(std::move(patch->info_));
+    }
+    ++patch;
+  }
+  return result;
+}
+} // namespace
+
+IncrementalTable::IncrementalTable(std::string prefix, mml::ConvertInfo ci)
+    : prefix_(std::move(prefix)), ci_(std::move(ci)) {}
+
+ParameterInfo IncrementalTable::ParseLine(std::string_view line) {
+  line.remove_prefix(prefix_.size());
+  mml::get_record_from_line(line, ',', record_);
+  return GetParameterInfo(record_, ci_);
+}
+
+IncrementalTable::PackedKey IncrementalTable::Pack(const std::string &type,
+                                                   uint32_t id) {
+  auto it = std::ranges::find(types_, type);
+  if (it == types_.end()) {
+    it = types_.insert(it, type);
+  }
+  return static_cast<PackedKey>(it - types_.begin()) << 32 | id;
+}
+
+KeyTypeId IncrementalTable::Unpack(PackedKey key) const {
+  return {types_[key >> 32], static_cast<uint32_t>(key)};
+}
+
+void IncrementalTable::Build(const std::vector<std::string_view> &lines) {
+  VectorParameterInfo data;
+  data.reserve(lines.size());
+  std::vector<LineKey> next;
+  next.reserve(lines.size());
+  for (auto line : lines) {
+    const ParameterInfo &info = data.emplace_back(ParseLine(line));
+    next.push_back({util::Hash64(line), Pack(info.type_, info.id_)});
+  }
+  std::ranges::sort(next, {}, &LineKey::hash_);
+  next.erase(std::ranges::unique(next, {}, &LineKey::hash_).begin(),
+             next.end());
+
+  KeysVector repeated;
+  fingerprint_ = SortTable(data, &repeated);
+  data_ = std::move(data);
+
+  changed_.clear();
+  changed_.reserve(data_.size());
+  for (const auto &info : data_) {
+    changed_.push_back({info.type_, info.id_});
+  }
+  repeated_.clear();
+  for (const auto &key : repeated) {
+    repeated_.emplace_back(Pack(key.type_, key.id_));
+  }
+  lines_ = std::move(next);
+  parsed_lines_ = lines.size();
+}
+
+const KeysVector &IncrementalTable::Update(const mml::LoadedFile &file) {
+  const std::vector<std::string_view> lines = file.GetLines(prefix_);
+  if (lines_.empty()) {
+    // nothing to reuse, parse the whole file at once
+    Build(lines);
+    return changed_;
+  }
+
+  // the lines sorted by hash are merged with the previous version, equal
+  // lines are next to each other with the first one in the file in front
+  std::vector<LinePos> order;
+  order.reserve(lines.size());
+  for (size_t i = 0, is = lines.size(); i != is; ++i) {
+    order.push_back({util::Hash64(lines[i]), i});
+  }
+  std::ranges::sort(order, [](const LinePos &a, const LinePos &b) {
+    return a.hash_ != b.hash_ ? a.hash_ < b.hash_ : a.line_ < b.line_;
+  });
+
+  std::vector<LineKey> next;
+  next.reserve(order.size());
+  std::vector<PackedKey> line_keys(lines.size());
+  std::unordered_map<size_t, ParameterInfo> parsed;
+  std::unordered_map<PackedKey, Candidate> candidates;
+  size_t parsed_lines = 0;
+  auto old = lines_.begin(), old_end = lines_.end();
+  for (size_t i = 0, is = order.size(); i != is;) {
+    const uint64_t hash = order[i].hash_;
+    for (; old != old_end && old->hash_ < hash; ++old) {
+      candidates.try_emplace(old->key_);
+    }
+    PackedKey key;
+    if (old != old_end && old->hash_ == hash) {
+      key = (old++)->key_;
+    } else {
+      ParameterInfo info = ParseLine(lines[order[i].line_]);
+      ++parsed_lines;
+      key = Pack(info.type_, info.id_);
+      candidates.try_emplace(key);
+      parsed.emplace(order[i].line_, std::move(info));
+    }
+    next.push_back({hash, key});
+    for (; i != is && order[i].hash_ == hash; ++i) {
+      line_keys[order[i].line_] = key;
+    }
+  }
+  for (; old != old_end; ++old) {
+    candidates.try_emplace(old->key_);
+  }
+  for (auto key : repeated_) {
+    candidates.try_emplace(key);
+  }
+
+  // the first line of a candidate in the new version gives its value
+  if (!candidates.empty()) {
+    for (size_t i = 0, is = lines.size(); i != is; ++i) {
+      auto it = candidates.find(line_keys[i]);
+      if (it == candidates.end() || it->second.lines_++ != 0) {
+        continue;
+      }
+      if (auto info = parsed.find(i); info != parsed.end()) {
+        it->second.info_ = std::move(info->second);
+      } else {
+        it->second.info_ = ParseLine(lines[i]);
+        ++parsed_lines;
+      }
+    }
+  }
+
+  std::vector<PackedKey> repeated;
+  std::vector<Patch> patches;
+  for (auto &[packed, candidate] : candidates) {
+    if (candidate.lines_ > 1) {
+      repeated.emplace_back(packed);
+    }
+    const ParameterInfo *current = FindParameter(data_, Unpack(packed));
+    if (!candidate.info_) {
+      if (current) {
+        patches.push_back({*current, true});
+      }
+    } else if (!current || current->value_ != candidate.info_->value_) {
+      patches.push_back({std::move(*candidate.info_), false});
+    }
+  }
+  std::ranges::sort(patches, [](const Patch &a, const Patch &b) {
+    return CompareKeys(a.info_, b.info_) < 0;
+  });
+
+  changed_.clear();
+  changed_.reserve(patches.size());
+  for (const auto &patch : patches) {
+    changed_.push_back({patch.info_.type_, patch.info_.id_});
+  }
+  if (!patches.empty()) {
+    data_ = ApplyPatches(data_, patches);
+    fingerprint_ = sft::GetFingerprint(data_);
+  }
+  lines_ = std::move(next);
+  repeated_ = std::move(repeated);
+  parsed_lines_ = parsed_lines;
+  return changed_;
+}
+
+} // namespace sft
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mml_utils.h"
+#include "param_compare.h"
+#include "params.h"
+
+namespace sft {
+
+// Sorted table of one dump that follows new versions of the file. A hash
+// of every command line is kept from the previous version, so an update
+// tokenizes only the lines that are new, patches the table in place and
+// reports the keys whose parameter changed. The table is the same as
+// Load followed by SortTable would give.
+class IncrementalTable {
+public:
+  IncrementalTable(std::string prefix, mml::ConvertInfo ci);
+
+  // Reads the lines of the prefix from file. Returns the sorted keys that
+  // were added, removed or got another value; the first update returns
+  // every key. Throws if a new line can't be converted, the table is
+  // unchanged then.
+  const KeysVector &Update(const mml::LoadedFile &file);
+
+  const VectorParameterInfo &GetData() const { return data_; }
+  const TableFingerprint &GetFingerprint() const { return fingerprint_; }
+  // Keys returned by the last update.
+  const KeysVector &GetChangedKeys() const { return changed_; }
+  // Lines tokenized by the last update.
+  size_t GetParsedLineCount() const { return parsed_lines_; }
+
+private:
+  // Key packed as the index of its type in types_ and the id.
+  using PackedKey = uint64_t;
+
+  struct LineKey {
+    uint64_t hash_ = 0;
+    PackedKey key_ = 0;
+  };
+
+  ParameterInfo ParseLine(std::string_view line);
+  PackedKey Pack(const std::string &type, uint32_t id);
+  KeyTypeId Unpack(PackedKey key) const;
+  // Parses every line, used when there is no previous version.
+  void Build(const std::vector<std::string_view> &lines);
+
+  std::string prefix_;
+  mml::ConvertInfo ci_;
+  mml::RecordView record_;
+  std::vector<std::string> types_;
+  // key of every distinct line of the last version, sorted by line hash
+  std::vector<LineKey> lines_;
+  // keys found on several lines, they are checked again on every update
+  // because the first of them wins
+  std::vector<PackedKey> repeated_;
+  VectorParameterInfo data_;
+  TableFingerprint fingerprint_;
+  KeysVector changed_;
+  size_t parsed_lines_ = 0;
+};
+
+} // namespace sft
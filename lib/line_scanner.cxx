@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define MML_SIMD_X86 1
+#endif
+
+#include "line_scanner.h"
+
+namespace mml {
+
+namespace {
+const char kNewLine = '\n';
+
+#ifdef MML_SIMD_X86
+bool is_line_start(std::string_view text, size_t pos) {
+  return pos == 0 || text[pos - 1] == kNewLine;
+}
+
+// Checks the candidates of one block and appends the matching offsets.
+template <typename Mask>
+void add_candidates(std::string_view text, std::string_view filter,
+                    size_t base, Mask mask, std::vector<size_t> &result) {
+  while (mask) {
+    size_t pos = base + __builtin_ctzll(mask);
+    if (text.substr(pos).starts_with(filter)) {
+      result.emplace_back(pos);
+    }
+    mask &= mask - 1;
+  }
+}
+
+void scan_tail(std::string_view text, std::string_view filter, size_t pos,
+               std::vector<size_t> &result) {
+  for (size_t is = text.size(); pos < is; ++pos) {
+    if (is_line_start(text, pos) && text.substr(pos).starts_with(filter)) {
+      result.emplace_back(pos);
+    }
+  }
+}
+
+void scan_head(std::string_view text, std::string_view filter,
+               std::vector<size_t> &result) {
+  if (!text.empty() && text.starts_with(filter)) {
+    result.emplace_back(0);
+  }
+}
+
+// Lane j of a block starting at i is a candidate when text[i + j - 1] is a
+// new line, text[i + j] == filter[0] and text[i + j + 1] == filter[1].
+// The loops keep one byte before and one after the block inside the text.
+void scan_sse2(std::string_view text, std::string_view filter,
+               std::vector<size_t> &result) {
+  const char *p = text.data();
+  const size_t n = text.size();
+  const size_t kBlock = 16;
+  const __m128i nl = _mm_set1_epi8(kNewLine);
+  const __m128i c0 = _mm_set1_epi8(filter.size() > 0 ? filter[0] : 0);
+  const __m128i c1 = _mm_set1_epi8(filter.size() > 1 ? filter[1] : 0);
+
+  scan_head(text, filter, result);
+  size_t i = 1;
+  for (; i + kBlock + 1 <= n; i += kBlock) {
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i - 1)), nl));
+    if (filter.size() > 0) {
+      mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)), c0));
+    }
+    if (filter.size() > 1) {
+      mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 1)), c1));
+    }
+    add_candidates(text, filter, i, mask, result);
+  }
+  scan_tail(text, filter, i, result);
+}
+
+__attribute__((target("avx2"))) void
+scan_avx2(std::string_view text, std::string_view filter,
+          std::vector<size_t> &result) {
+  const char *p = text.data();
+  const size_t n = text.size();
+  const size_t kBlock = 32;
+  const __m256i nl = _mm256_set1_epi8(kNewLine);
+  const __m256i c0 = _mm256_set1_epi8(filter.size() > 0 ? filter[0] : 0);
+  const __m256i c1 = _mm256_set1_epi8(filter.size() > 1 ? filter[1] : 0);
+
+  scan_head(text, filter, result);
+  size_t i = 1;
+  for (; i + kBlock + 1 <= n; i += kBlock) {
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i - 1)),
+        nl));
+    if (filter.size() > 0) {
+      mask &= _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i)), c0));
+    }
+    if (filter.size() > 1) {
+      mask &= _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + 1)),
+          c1));
+    }
+    add_candidates(text, filter, i, mask, result);
+  }
+  scan_tail(text, filter, i, result);
+}
+#endif
+} // namespace
+
+std::vector<size_t> find_line_starts_scalar(std::string_view text,
+                                            std::string_view filter) {
+  std::vector<size_t> result;
+  const char *begin = text.data();
+  const char *end = begin + text.size();
+  for (const char *p = begin; p < end;) {
+    std::string_view line(p, end - p);
+    if (line.starts_with(filter)) {
+      result.emplace_back(p - begin);
+    }
+    auto next = static_cast<const char *>(std::memchr(p, kNewLine, end - p));
+    if (!next) {
+      break;
+    }
+    p = next + 1;
+  }
+  return result;
+}
+
+std::vector<size_t> find_line_starts(std::string_view text,
+                                     std::string_view filter) {
+#ifdef MML_SIMD_X86
+  std::vector<size_t> result;
+  if (__builtin_cpu_supports("avx2")) {
+    scan_avx2(text, filter, result);
+  } else {
+    scan_sse2(text, filter, result);
+  }
+  return result;
+#else
+  return find_line_starts_scalar(text, filter);
+#endif
+}
+
+} // namespace mml
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace mml {
+
+// Offsets of the lines of text that start with filter. Line starts and the
+// first two bytes of filter are matched 16 or 32 bytes at a time with
+// SSE2/AVX2 where available; the rest of filter is checked per candidate.
+std::vector<size_t> find_line_starts(std::string_view text,
+                                     std::string_view filter);
+
+// Portable implementation with the same result, used where SIMD is missing.
+std::vector<size_t> find_line_starts_scalar(std::string_view text,
+                                            std::string_view filter);
+
+} // namespace mml
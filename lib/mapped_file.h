@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace mml {
+
+// Read-only view of a whole file. On POSIX systems the file is mapped into
+// memory, elsewhere it is read into an owned buffer.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  std::string_view GetData() const { return {data_, size_}; }
+  size_t GetSize() const { return size_; }
+
+private:
+  void Reset() noexcept;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::unique_ptr<char[]> buffer_;
+};
+
+} // namespace mml
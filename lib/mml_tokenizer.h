@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace mml {
+
+enum class CharClass : uint8_t { Other, Space, Delimiter, Equal, Quote, End };
+
+using CharClassTable = std::array<CharClass, 256>;
+
+constexpr CharClassTable MakeCharClasses(char delimiter) {
+  CharClassTable table{};
+  auto set = [&table](char ch, CharClass cls) {
+    table[static_cast<unsigned char>(ch)] = cls;
+  };
+  set(' ', CharClass::Space);
+  set('\t', CharClass::Space);
+  set('=', CharClass::Equal);
+  set('"', CharClass::Quote);
+  set('\'', CharClass::Quote);
+  set(';', CharClass::End);
+  set('\r', CharClass::End);
+  set('\n', CharClass::End);
+  set(delimiter, CharClass::Delimiter);
+  return table;
+}
+
+inline constexpr CharClassTable kMmlCharClasses = MakeCharClasses(',');
+
+// Splits the parameters of one MML command ("K1=V1, K2=\"V,2\";") in one
+// sweep and calls f(key, value) for every item that has a key. Quoted values
+// keep delimiters, '=' and spaces; unquoted keys and values are trimmed of
+// spaces. Items without '=' are skipped, ';' or a line end outside quotes
+// finishes the command.
+template <typename F>
+constexpr void tokenize_command(std::string_view line,
+                                const CharClassTable &table, F &&f) {
+  enum class State { Key, ValueStart, Value, Quoted, AfterQuote };
+
+  const size_t npos = std::string_view::npos;
+  State state = State::Key;
+  char quote = 0;
+  size_t key_begin = npos, key_end = npos;
+  size_t value_begin = npos, value_end = npos;
+
+  auto emit = [&]() {
+    if (key_begin != npos) {
+      std::string_view value;
+      if (value_begin != npos) {
+        value = line.substr(value_begin, value_end - value_begin);
+      }
+      f(line.substr(key_begin, key_end - key_begin), value);
+    }
+    key_begin = key_end = value_begin = value_end = npos;
+    state = State::Key;
+  };
+
+  for (size_t i = 0, n = line.size(); i != n; ++i) {
+    const char ch = line[i];
+    const CharClass cls = table[static_cast<unsigned char>(ch)];
+    switch (state) {
+    case State::Key:
+      if (cls == CharClass::Other) {
+        key_begin = key_begin == npos ? i : key_begin;
+        key_end = i + 1;
+      } else if (cls == CharClass::Equal) {
+        state = State::ValueStart;
+      } else if (cls == CharClass::Delimiter) {
+        key_begin = key_end = npos;
+      } else if (cls == CharClass::End) {
+        return;
+      }
+      break;
+    case State::ValueStart:
+      if (cls == CharClass::Quote) {
+        quote = ch;
+        value_begin = value_end = i + 1;
+        state = State::Quoted;
+      } else if (cls == CharClass::Delimiter) {
+        emit();
+      } else if (cls == CharClass::End) {
+        emit();
+        return;
+      } else if (cls != CharClass::Space) {
+        value_begin = i;
+        value_end = i + 1;
+        state = State::Value;
+      }
+      break;
+    case State::Value:
+      if (cls == CharClass::Delimiter) {
+        emit();
+      } else if (cls == CharClass::End) {
+        emit();
+        return;
+      } else if (cls != CharClass::Space) {
+        value_end = i + 1;
+      }
+      break;
+    case State::Quoted:
+      if (ch == quote) {
+        state = State::AfterQuote;
+      } else {
+        value_end = i + 1;
+      }
+      break;
+    case State::AfterQuote:
+      if (cls == CharClass::Delimiter) {
+        emit();
+      } else if (cls == CharClass::End) {
+        emit();
+        return;
+      }
+      break;
+    }
+  }
+  if (state != State::Key) {
+    emit();
+  }
+}
+
+} // namespace mml
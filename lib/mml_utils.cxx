@@ -2,37 +2,71 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <ranges>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "line_scanner.h"
+#include "mml_tokenizer.h"
 #include "mml_utils.h"
 
 namespace mml {
 const size_t kOne = 1ul;
-const char kCharEq = '=';
+// typical SET SOFTPARA command: DT, number and value
+const size_t kFieldsPerRecord = 4ul;
+const size_t kMinArenaSize = 1024ul;
 const char kCharComma = ',';
 
+// Runs the tokenizer with the prebuilt table for the usual comma delimiter.
+template <typename F>
+void tokenize(std::string_view line, const char delimiter, F &&f) {
+  if (delimiter == kCharComma) {
+    tokenize_command(line, kMmlCharClasses, f);
+  } else {
+    const CharClassTable table = MakeCharClasses(delimiter);
+    tokenize_command(line, table, f);
+  }
+}
+
 MapStringString get_map_from_line(std::string_view line, const char delimiter) {
-  static std::set<char> chars = {'\n', '\r', ' ', ';'};
-  static std::set<char> spaces_brakets = {'\"', '\'', ' '};
   MapStringString result;
+  tokenize(line, delimiter,
+           [&result](std::string_view key, std::string_view value) {
+             result.data_.insert_or_assign(std::string(key),
+                                           std::string(value));
+           });
+  return result;
+}
 
-  line = trim(line, chars);
-
-  for (auto item : split(line, delimiter)) {
-    auto key_value = split(item, kCharEq);
-    if (key_value.size() == 2) {
-      std::string key = std::string(trim(key_value[0], spaces_brakets));
-      std::string value = std::string(trim(key_value[1], spaces_brakets));
-      result.data_[key] = value;
-    }
-  }
-
+RecordView get_record_from_line(std::string_view line, const char delimiter) {
+  RecordView result;
+  get_record_from_line(line, delimiter, result);
   return result;
 }
 
+void get_record_from_line(std::string_view line, const char delimiter,
+                          RecordView &record) {
+  record.data_.clear();
+  record.data_.reserve(kFieldsPerRecord);
+  tokenize(line, delimiter,
+           [&record](std::string_view key, std::string_view value) {
+             // keep the last value of a repeated key as the map does
+             auto it = std::ranges::find(record.data_, key, &FieldView::key_);
+             if (it != record.data_.end()) {
+               it->value_ = value;
+             } else {
+               record.data_.emplace_back(key, value);
+             }
+           });
+}
+
+VectorRecordView::VectorRecordView(size_t initial_size)
+    : arena_(std::make_unique<std::pmr::monotonic_buffer_resource>(
+          std::max(initial_size, kMinArenaSize))),
+      data_(arena_.get()) {}
+
 VectorMapStringString get_vector_map_str_str(const TrimResult &v) {
   VectorMapStringString r;
   std::transform(
@@ -89,12 +123,22 @@ std::string_view trim_prefix(std::string_view line, std::string_view prefix) {
 }
 
 SearchResult get_lines_by_prefix(std::istream &in, std::string_view prefix) {
-  std::string line;
+  std::string text{std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>()};
   SearchResult result;
-  while (getline(in, line)) {
-    if (line.starts_with(prefix)) {
-      result.data_.emplace_back(std::move(line));
-    }
+  for (auto line : get_lines_by_prefix(text, prefix)) {
+    result.data_.emplace_back(line);
+  }
+  return result;
+}
+
+std::vector<std::string_view> get_lines_by_prefix(std::string_view text,
+                                                  std::string_view prefix) {
+  std::vector<std::string_view> result;
+  auto offsets = find_line_starts(text, prefix);
+  result.reserve(offsets.size());
+  for (auto offset : offsets) {
+    result.emplace_back(get_line_at(text, offset));
   }
   return result;
 }
@@ -150,6 +194,142 @@ std::string GetItemByKey(const mml::MapStringString &dict,
   return result;
 }
 
+std::string_view GetItemByKey(const RecordView &record, std::string_view key) {
+  std::string_view result;
+  if (auto it = std::ranges::find(record.data_, key, &FieldView::key_);
+      it != record.data_.end()) {
+    result = it->value_;
+  }
+  return result;
+}
+
+namespace {
+// The scanner filters lines by the part common to all prefixes.
+std::string_view get_common_prefix(const std::vector<std::string> &prefixes) {
+  std::string_view common;
+  if (!prefixes.empty()) {
+    common = prefixes[0];
+  }
+  for (const auto &prefix : prefixes) {
+    auto [it, _] = std::ranges::mismatch(common, prefix);
+    common = common.substr(0, it - common.begin());
+  }
+  return common;
+}
+} // namespace
+
+CommandIndex index_commands(std::string_view text,
+                            const std::vector<std::string> &prefixes) {
+  CommandIndex result;
+  std::vector<LineOffsets *> offsets;
+  offsets.reserve(prefixes.size());
+  for (const auto &prefix : prefixes) {
+    offsets.emplace_back(&result.data_[prefix]);
+  }
+  if (prefixes.empty()) {
+    return result;
+  }
+
+  for (auto pos : find_line_starts(text, get_common_prefix(prefixes))) {
+    std::string_view line = text.substr(pos);
+    for (size_t i = 0, is = prefixes.size(); i != is; ++i) {
+      if (line.starts_with(prefixes[i])) {
+        offsets[i]->data_.emplace_back(pos);
+      }
+    }
+  }
+  return result;
+}
+
+std::string_view get_line_at(std::string_view text, size_t offset) {
+  text.remove_prefix(std::min(offset, text.size()));
+  return text.substr(0, text.find('\n'));
+}
+
+void scan_commands(
+    std::string_view text, const std::vector<std::string> &prefixes,
+    size_t window_size,
+    const std::function<void(size_t, std::string_view)> &f) {
+  if (prefixes.empty()) {
+    return;
+  }
+  std::string_view common = get_common_prefix(prefixes);
+  window_size = std::max(window_size, kOne);
+
+  for (size_t pos = 0, size = text.size(); pos < size;) {
+    // cut the window after its last new line, or after the first one if
+    // a single line is longer than the window
+    size_t end = std::min(pos + window_size, size);
+    if (end < size) {
+      size_t eol = text.rfind('\n', end - kOne);
+      if (eol == std::string_view::npos || eol < pos) {
+        eol = text.find('\n', end);
+      }
+      end = eol == std::string_view::npos ? size : eol + kOne;
+    }
+
+    std::string_view window = text.substr(pos, end - pos);
+    for (auto offset : find_line_starts(window, common)) {
+      std::string_view line = get_line_at(window, offset);
+      for (size_t i = 0, is = prefixes.size(); i != is; ++i) {
+        if (line.starts_with(prefixes[i])) {
+          f(i, line);
+        }
+      }
+    }
+    pos = end;
+  }
+}
+
+LoadedFile::LoadedFile(const std::string &filename,
+                       const std::vector<std::string> &prefixes)
+    : file_(filename), index_(index_commands(file_.GetData(), prefixes)) {}
+
+LoadedFile::LoadedFile(MappedFile file,
+                       const std::vector<std::string> &prefixes)
+    : file_(std::move(file)),
+      index_(index_commands(file_.GetData(), prefixes)) {}
+
+LoadedFile::LoadedFile(const std::string &filename, std::string_view prefix)
+    : LoadedFile(filename, std::vector<std::string>{std::string(prefix)}) {}
+
+std::vector<std::string_view>
+LoadedFile::GetLines(std::string_view prefix) const {
+  std::vector<std::string_view> result;
+  if (auto it = index_.data_.find(prefix); it != index_.data_.end()) {
+    result.reserve(it->second.data_.size());
+    for (auto offset : it->second.data_) {
+      result.emplace_back(get_line_at(GetData(), offset));
+    }
+  }
+  return result;
+}
+
+VectorRecordView LoadedFile::GetRecords(std::string_view prefix) const {
+  auto lines = GetLines(prefix);
+  const size_t record_size =
+      sizeof(RecordView) + kFieldsPerRecord * sizeof(FieldView);
+  VectorRecordView result(lines.size() * record_size);
+  result.data_.reserve(lines.size());
+  for (auto line : lines) {
+    line.remove_prefix(prefix.size());
+    get_record_from_line(line, kCharComma, result.data_.emplace_back());
+  }
+  return result;
+}
+
+std::string GetNeName(const LoadedFile &file, std::string_view prefix,
+                      std::string_view name_field) {
+  std::string name;
+  auto lines = file.GetLines(prefix);
+  if (!lines.empty()) {
+    lines[0].remove_prefix(prefix.size());
+    auto command = get_record_from_line(lines[0], kCharComma);
+    name = GetItemByKey(command, name_field);
+  }
+  return name;
+}
+
 VectorMapStringString Load(const std::string &filename,
                            const std::string &prefix) {
   std::ifstream input(filename);
@@ -1,11 +1,16 @@
 #pragma once
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "mapped_file.h"
+
 namespace mml {
 
 struct SearchResult {
@@ -24,6 +29,54 @@ struct VectorMapStringString {
   std::vector<MapStringString> data_;
 };
 
+// Key/value pair pointing into a loaded file.
+struct FieldView {
+  std::string_view key_;
+  std::string_view value_;
+};
+
+// Flat list of the fields of one command. The storage comes from the
+// memory resource of the owning container, see VectorRecordView.
+struct RecordView {
+  using allocator_type = std::pmr::polymorphic_allocator<FieldView>;
+
+  RecordView() = default;
+  explicit RecordView(const allocator_type &alloc) : data_(alloc) {}
+  RecordView(const RecordView &other, const allocator_type &alloc)
+      : data_(other.data_, alloc) {}
+  RecordView(RecordView &&other, const allocator_type &alloc)
+      : data_(std::move(other.data_), alloc) {}
+  RecordView(const RecordView &) = default;
+  RecordView(RecordView &&) = default;
+  RecordView &operator=(const RecordView &) = default;
+  RecordView &operator=(RecordView &&) = default;
+
+  std::pmr::vector<FieldView> data_;
+};
+
+// Records of one command family. The records and their fields are allocated
+// from a monotonic arena owned by this object and released all at once.
+struct VectorRecordView {
+  explicit VectorRecordView(size_t initial_size = 0);
+
+  VectorRecordView(const VectorRecordView &) = delete;
+  VectorRecordView &operator=(const VectorRecordView &) = delete;
+  VectorRecordView(VectorRecordView &&) = default;
+  VectorRecordView &operator=(VectorRecordView &&) = delete;
+
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+  std::pmr::vector<RecordView> data_;
+};
+
+// Offsets of the lines starting with one command prefix.
+struct LineOffsets {
+  std::vector<size_t> data_;
+};
+
+struct CommandIndex {
+  std::map<std::string, LineOffsets, std::less<>> data_;
+};
+
 struct ConvertInfo {
   mml::MapStringString type_to_number_;
   mml::MapStringString type_to_value_;
@@ -41,9 +94,27 @@ std::string_view trim_prefix(std::string_view line, std::string_view prefix);
 TrimResult trim_prefix(SearchResult &v, std::string_view prefix);
 
 SearchResult get_lines_by_prefix(std::istream &in, std::string_view prefix);
+std::vector<std::string_view> get_lines_by_prefix(std::string_view text,
+                                                  std::string_view prefix);
+
+CommandIndex index_commands(std::string_view text,
+                            const std::vector<std::string> &prefixes);
+std::string_view get_line_at(std::string_view text, size_t offset);
+
+// Calls f(prefix index, line) for every line that starts with one of the
+// prefixes. The text is scanned window_size bytes at a time, so no index
+// of the whole text is built.
+void scan_commands(
+    std::string_view text, const std::vector<std::string> &prefixes,
+    size_t window_size,
+    const std::function<void(size_t, std::string_view)> &f);
 
 MapStringString get_map_from_line(std::string_view line, const char delimiter);
 
+RecordView get_record_from_line(std::string_view line, const char delimiter);
+void get_record_from_line(std::string_view line, const char delimiter,
+                          RecordView &record);
+
 VectorMapStringString get_vector_map_str_str(const TrimResult &v);
 void print(std::ostream &os, const VectorMapStringString &vm);
 
@@ -51,6 +122,7 @@ std::string get_ne_name(std::istream &in, std::string_view prefix,
                         const std::string &name_field);
 
 std::string GetItemByKey(const MapStringString &dict, const std::string &key);
+std::string_view GetItemByKey(const RecordView &record, std::string_view key);
 
 VectorMapStringString Load(const std::string &filename,
                            const std::string &prefix);
@@ -58,4 +130,33 @@ VectorMapStringString Load(const std::string &filename,
 std::string LoadNeName(const std::string &filename, const std::string &prefix,
                        const std::string &ne_name);
 
+// Memory mapped file indexed by command prefixes in a single pass. Keys and
+// values of the records point into the mapping and stay valid while the
+// object lives.
+class LoadedFile {
+public:
+  LoadedFile(const std::string &filename,
+             const std::vector<std::string> &prefixes);
+  LoadedFile(const std::string &filename, std::string_view prefix);
+  LoadedFile(MappedFile file, const std::vector<std::string> &prefixes);
+
+  LoadedFile(const LoadedFile &) = delete;
+  LoadedFile &operator=(const LoadedFile &) = delete;
+  LoadedFile(LoadedFile &&) = default;
+  LoadedFile &operator=(LoadedFile &&) = default;
+
+  const CommandIndex &GetIndex() const { return index_; }
+  std::string_view GetData() const { return file_.GetData(); }
+
+  std::vector<std::string_view> GetLines(std::string_view prefix) const;
+  VectorRecordView GetRecords(std::string_view prefix) const;
+
+private:
+  MappedFile file_;
+  CommandIndex index_;
+};
+
+std::string GetNeName(const LoadedFile &file, std::string_view prefix,
+                      std::string_view name_field);
+
 } // namespace mml
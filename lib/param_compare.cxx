@@ -1,9 +1,20 @@
 #include <algorithm>
+#include <bit>
+#include <charconv>
 #include <cstdint>
 #include <iterator>
+#include <optional>
 #include <ranges>
+#include <stdexcept>
 #include <string>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define SFT_SIMD_X86 1
+#endif
+
+#include "charconv_util.h"
+#include "hash_util.h"
 #include "param_compare.h"
 #include "params.h"
 
@@ -40,70 +51,523 @@ sft::KeysVector CreateCommonIndex(const sft::VectorParameterInfo &v1,
   return index;
 }
 
-void BitDifference::Init(const DifferenceInfo &info) {
-  BitSoftParameter param1(info.value1_);
-  BitSoftParameter param2(info.value2_);
-  uint8_t diff = param1.GetValue() ^ param2.GetValue();
-  if (diff) {
-    details_.emplace_back(info.type_ + std::to_string(info.id_));
+int CompareKeys(const ParameterInfo &a, const ParameterInfo &b) {
+  if (int order = a.type_.compare(b.type_); order != 0) {
+    return order;
   }
+  return a.id_ < b.id_ ? -1 : a.id_ > b.id_ ? 1 : 0;
 }
 
-std::vector<int> GetBitsNumbers(uint32_t n, int bits) {
-  std::vector<int> result;
-  result.reserve(bits);
-  for (int i = 0; i < bits && n; ++i, n >>= 1) {
-    if (n & 1) {
-      result.emplace_back(i + 1);
+void SortByKey(VectorParameterInfo &v) {
+  std::ranges::stable_sort(
+      v, [](const ParameterInfo &a, const ParameterInfo &b) {
+        return CompareKeys(a, b) < 0;
+      });
+}
+
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const VectorParameterInfo &v2) {
+  VectorParameterPair result;
+  MergeJoin(v1, v2,
+            [&result](const ParameterPair &pair) { result.push_back(pair); });
+  return result;
+}
+
+const ParameterInfo *FindParameter(std::span<const ParameterInfo> v,
+                                   const KeyTypeId &key) {
+  auto it = std::lower_bound(v.begin(), v.end(), key,
+                             [](const ParameterInfo &a, const KeyTypeId &b) {
+                               if (int order = a.type_.compare(b.type_)) {
+                                 return order < 0;
+                               }
+                               return a.id_ < b.id_;
+                             });
+  return it != v.end() && it->type_ == key.type_ && it->id_ == key.id_
+             ? &*it
+             : nullptr;
+}
+
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const VectorParameterInfo &v2,
+                                           std::span<const KeyTypeId> keys) {
+  VectorParameterPair result;
+  for (const auto &key : keys) {
+    const ParameterInfo *left = FindParameter(v1, key);
+    const ParameterInfo *right = FindParameter(v2, key);
+    if ((left || right) && (!left || !right || left->value_ != right->value_)) {
+      result.push_back({left, right});
+    }
+  }
+  return result;
+}
+
+size_t CountCommonKeys(std::span<const ParameterInfo> v1,
+                       std::span<const ParameterInfo> v2) {
+  size_t result = 0;
+  auto it1 = v1.begin(), end1 = v1.end();
+  auto it2 = v2.begin(), end2 = v2.end();
+  while (it1 != end1 || it2 != end2) {
+    int order = it1 == end1 ? 1 : it2 == end2 ? -1 : CompareKeys(*it1, *it2);
+    const ParameterInfo &key = order <= 0 ? *it1 : *it2;
+    while (it1 != end1 && CompareKeys(key, *it1) == 0) {
+      ++it1;
+    }
+    while (it2 != end2 && CompareKeys(key, *it2) == 0) {
+      ++it2;
+    }
+    ++result;
+  }
+  return result;
+}
+
+namespace {
+// Incremental fingerprint of a sorted table.
+class FingerprintBuilder {
+public:
+  void Add(const ParameterInfo &info, size_t index) {
+    if (result_.types_.empty() || result_.types_.back().type_ != info.type_) {
+      Close();
+      result_.types_.push_back({info.type_, index, index,
+                                util::Hash64(info.type_)});
+    }
+    TypeFingerprint &type = result_.types_.back();
+    type.hash_ = util::HashCombine(type.hash_, info.id_);
+    type.hash_ = util::HashCombine(type.hash_, util::Hash64(info.value_));
+    type.end_ = index + 1;
+  }
+  TableFingerprint Finish() {
+    Close();
+    return std::move(result_);
+  }
+
+private:
+  void Close() {
+    if (!result_.types_.empty()) {
+      result_.hash_ =
+          util::HashCombine(result_.hash_, result_.types_.back().hash_);
+    }
+  }
+
+  TableFingerprint result_;
+};
+} // namespace
+
+TableFingerprint SortTable(VectorParameterInfo &v, KeysVector *repeated) {
+  SortByKey(v);
+
+  FingerprintBuilder builder;
+  size_t out = 0;
+  size_t last_repeated = 0;
+  for (size_t i = 0, is = v.size(); i != is; ++i) {
+    if (out != 0 && CompareKeys(v[out - 1], v[i]) == 0) {
+      if (repeated && last_repeated != out) {
+        repeated->push_back({v[out - 1].type_, v[out - 1].id_});
+        last_repeated = out;
+      }
+      continue;
+    }
+    if (out != i) {
+      v[out] = std::move(v[i]);
+    }
+    builder.Add(v[out], out);
+    ++out;
+  }
+  v.erase(v.begin() + out, v.end());
+  return builder.Finish();
+}
+
+TableFingerprint GetFingerprint(const VectorParameterInfo &v) {
+  FingerprintBuilder builder;
+  for (size_t i = 0, is = v.size(); i != is; ++i) {
+    builder.Add(v[i], i);
+  }
+  return builder.Finish();
+}
+
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const TableFingerprint &f1,
+                                           const VectorParameterInfo &v2,
+                                           const TableFingerprint &f2) {
+  VectorParameterPair result;
+  if (f1.hash_ == f2.hash_ && v1.size() == v2.size()) {
+    return result;
+  }
+
+  auto add = [&result](const ParameterPair &pair) { result.push_back(pair); };
+  auto section = [](const VectorParameterInfo &v, const TypeFingerprint &t) {
+    return std::span<const ParameterInfo>(v).subspan(t.begin_,
+                                                     t.end_ - t.begin_);
+  };
+
+  // the sections are in type order, so they are merged like keys
+  auto it1 = f1.types_.begin(), end1 = f1.types_.end();
+  auto it2 = f2.types_.begin(), end2 = f2.types_.end();
+  while (it1 != end1 || it2 != end2) {
+    int order = it1 == end1   ? 1
+                : it2 == end2 ? -1
+                              : it1->type_.compare(it2->type_);
+    if (order < 0) {
+      MergeJoin(section(v1, *it1++), {}, add);
+    } else if (order > 0) {
+      MergeJoin({}, section(v2, *it2++), add);
+    } else {
+      if (it1->hash_ != it2->hash_ ||
+          it1->end_ - it1->begin_ != it2->end_ - it2->begin_) {
+        MergeJoin(section(v1, *it1), section(v2, *it2), add);
+      }
+      ++it1;
+      ++it2;
     }
   }
   return result;
 }
 
-void ByteDifference::Init(const DifferenceInfo &info) {
-  using namespace std::string_literals;
+uint32_t GetDifferenceMask(ValueKind kind, std::string_view value1,
+                           std::string_view value2) {
+  if (kind == ValueKind::String) {
+    return value1 != value2 ? 1u : 0u;
+  }
+  return GetNumericValue(kind, value1) ^ GetNumericValue(kind, value2);
+}
 
-  ByteSoftParameter param1(info.value1_);
-  ByteSoftParameter param2(info.value2_);
-  uint8_t diff = param1.GetValue() ^ param2.GetValue();
-  if (diff) {
-    auto bits = GetBitsNumbers(diff, 8);
-    details_.resize(0);
-    details_.reserve(bits.size());
-    std::string param_name = " of "s + info.type_ + std::to_string(info.id_);
-    for (auto b : bits) {
-      details_.emplace_back("BIT"s + std::to_string(b) + param_name);
+namespace {
+template <typename T>
+void XorTail(std::span<const T> left, std::span<const T> right,
+             std::span<T> out, size_t i, std::vector<uint32_t> &lanes) {
+  for (size_t is = out.size(); i < is; ++i) {
+    out[i] = left[i] ^ right[i];
+    if (out[i]) {
+      lanes.emplace_back(static_cast<uint32_t>(i));
     }
   }
 }
 
-void DwordDifference::Init(const DifferenceInfo &info) {
-  using namespace std::string_literals;
+// Appends the lanes of the set bits of a movemask result.
+void AddLanes(size_t base, uint32_t mask, std::vector<uint32_t> &lanes) {
+  ForEachBit(mask, [&lanes, base](int bit) {
+    lanes.emplace_back(static_cast<uint32_t>(base + bit - 1));
+  });
+}
+
+#ifdef SFT_SIMD_X86
+// Each block: XOR, compare with zero, movemask of the lanes that differ.
+void XorSse2(std::span<const uint8_t> left, std::span<const uint8_t> right,
+             std::span<uint8_t> out, std::vector<uint32_t> &lanes) {
+  const size_t kLanes = 16;
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + kLanes <= out.size(); i += kLanes) {
+    __m128i x = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(&left[i])),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(&right[i])));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&out[i]), x);
+    AddLanes(i, ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) & 0xffffu, lanes);
+  }
+  XorTail(left, right, out, i, lanes);
+}
+
+void XorSse2(std::span<const uint32_t> left, std::span<const uint32_t> right,
+             std::span<uint32_t> out, std::vector<uint32_t> &lanes) {
+  const size_t kLanes = 4;
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + kLanes <= out.size(); i += kLanes) {
+    __m128i x = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(&left[i])),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(&right[i])));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&out[i]), x);
+    uint32_t mask =
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, zero)));
+    AddLanes(i, ~mask & 0xfu, lanes);
+  }
+  XorTail(left, right, out, i, lanes);
+}
+
+__attribute__((target("avx2"))) void
+XorAvx2(std::span<const uint8_t> left, std::span<const uint8_t> right,
+        std::span<uint8_t> out, std::vector<uint32_t> &lanes) {
+  const size_t kLanes = 32;
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + kLanes <= out.size(); i += kLanes) {
+    __m256i x = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&left[i])),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&right[i])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&out[i]), x);
+    AddLanes(i, ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero)), lanes);
+  }
+  XorTail(left, right, out, i, lanes);
+}
+
+__attribute__((target("avx2"))) void
+XorAvx2(std::span<const uint32_t> left, std::span<const uint32_t> right,
+        std::span<uint32_t> out, std::vector<uint32_t> &lanes) {
+  const size_t kLanes = 8;
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + kLanes <= out.size(); i += kLanes) {
+    __m256i x = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&left[i])),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&right[i])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&out[i]), x);
+    uint32_t mask =
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, zero)));
+    AddLanes(i, ~mask & 0xffu, lanes);
+  }
+  XorTail(left, right, out, i, lanes);
+}
+#endif
+
+template <typename T>
+std::vector<uint32_t> XorColumnsImpl(std::span<const T> left,
+                                     std::span<const T> right,
+                                     std::span<T> out) {
+  if (left.size() != out.size() || right.size() != out.size()) {
+    throw std::invalid_argument("Columns of different sizes.");
+  }
+  std::vector<uint32_t> lanes;
+#ifdef SFT_SIMD_X86
+  if (__builtin_cpu_supports("avx2")) {
+    XorAvx2(left, right, out, lanes);
+  } else {
+    XorSse2(left, right, out, lanes);
+  }
+#else
+  XorTail(left, right, out, 0, lanes);
+#endif
+  return lanes;
+}
+
+template <typename T>
+std::vector<uint32_t> XorColumnsScalarImpl(std::span<const T> left,
+                                           std::span<const T> right,
+                                           std::span<T> out) {
+  if (left.size() != out.size() || right.size() != out.size()) {
+    throw std::invalid_argument("Columns of different sizes.");
+  }
+  std::vector<uint32_t> lanes;
+  XorTail(left, right, out, 0, lanes);
+  return lanes;
+}
+} // namespace
+
+std::vector<uint32_t> XorColumns(std::span<const uint8_t> left,
+                                 std::span<const uint8_t> right,
+                                 std::span<uint8_t> out) {
+  return XorColumnsImpl(left, right, out);
+}
+
+std::vector<uint32_t> XorColumns(std::span<const uint32_t> left,
+                                 std::span<const uint32_t> right,
+                                 std::span<uint32_t> out) {
+  return XorColumnsImpl(left, right, out);
+}
+
+std::vector<uint32_t> XorColumnsScalar(std::span<const uint8_t> left,
+                                       std::span<const uint8_t> right,
+                                       std::span<uint8_t> out) {
+  return XorColumnsScalarImpl(left, right, out);
+}
+
+std::vector<uint32_t> XorColumnsScalar(std::span<const uint32_t> left,
+                                       std::span<const uint32_t> right,
+                                       std::span<uint32_t> out) {
+  return XorColumnsScalarImpl(left, right, out);
+}
+
+namespace {
+void AppendNumber(std::string &out, uint32_t n) {
+  char buffer[16];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), n);
+  out.append(buffer, end);
+}
+
+bool HasBitDetails(ValueKind kind) {
+  return kind == ValueKind::Byte || kind == ValueKind::Dword;
+}
+
+// Calls f(bit) once per detail line, bit is 0 for kinds that report a
+// single line.
+template <typename F> void ForEachDetail(ValueKind kind, uint32_t mask, F &&f) {
+  if (!mask) {
+    return;
+  }
+  if (!HasBitDetails(kind)) {
+    f(0);
+    return;
+  }
+  ForEachBit(mask, f);
+}
+
+void AppendDetail(std::string &out, ValueKind kind, std::string_view type,
+                  uint32_t id, int bit) {
+  switch (kind) {
+  case ValueKind::Bit:
+    out.append(type);
+    AppendNumber(out, id);
+    break;
+  case ValueKind::Byte:
+  case ValueKind::Dword:
+    out.append("BIT");
+    AppendNumber(out, bit);
+    out.append(" of ");
+    out.append(type);
+    AppendNumber(out, id);
+    break;
+  case ValueKind::String:
+    out.append("Strings are different.");
+    break;
+  }
+}
+} // namespace
+
+DifferenceDetails GetDetails(ValueKind kind, std::string_view type,
+                             uint32_t id, uint32_t mask) {
+  DifferenceDetails details;
+  details.reserve(GetDetailCount(kind, mask));
+  ForEachDetail(kind, mask, [&](int bit) {
+    AppendDetail(details.emplace_back(), kind, type, id, bit);
+  });
+  return details;
+}
+
+void AppendDetails(std::string &out, ValueKind kind, std::string_view type,
+                   uint32_t id, uint32_t mask) {
+  ForEachDetail(kind, mask, [&](int bit) {
+    AppendDetail(out, kind, type, id, bit);
+    out.push_back('\n');
+  });
+}
+
+size_t GetDetailCount(ValueKind kind, uint32_t mask) {
+  if (!mask) {
+    return 0;
+  }
+  return HasBitDetails(kind) ? std::popcount(mask) : 1;
+}
+
+namespace {
+// Value of a missing parameter is empty.
+std::string_view GetValue(const ParameterInfo *info) {
+  return info ? std::string_view(info->value_) : std::string_view();
+}
+} // namespace
+
+DifferenceRecord MakeDifference(ValueKind kind, const ParameterPair &pair) {
+  DifferenceRecord record{pair.left_, pair.right_, 0, kind};
+  if (kind == ValueKind::String) {
+    record.mask_ =
+        GetDifferenceMask(kind, GetValue(pair.left_), GetValue(pair.right_));
+  } else {
+    record.left_number_ = GetNumericValue(kind, GetValue(pair.left_));
+    record.right_number_ = GetNumericValue(kind, GetValue(pair.right_));
+    record.mask_ = record.left_number_ ^ record.right_number_;
+  }
+  return record;
+}
 
-  DwordSoftParameter param1(info.value1_);
-  DwordSoftParameter param2(info.value2_);
-  uint32_t diff = param1.GetValue() ^ param2.GetValue();
-  if (diff) {
-    auto bits = GetBitsNumbers(diff, 32);
-    details_.resize(0);
-    details_.reserve(bits.size());
-    std::string param_name = " of "s + info.type_ + std::to_string(info.id_);
-    for (auto b : bits) {
-      details_.emplace_back("BIT"s + std::to_string(b) + param_name);
+namespace {
+// find_kind is called once per run of pairs of the same type.
+template <typename F>
+VectorDifferenceRecord MakeDifferencesBy(const VectorParameterPair &pairs,
+                                         F &&find_kind) {
+  VectorDifferenceRecord result;
+  result.reserve(pairs.size());
+  std::vector<uint32_t> left, right, numeric;
+  const std::string *type = nullptr;
+  std::optional<ValueKind> kind;
+  for (const auto &pair : pairs) {
+    const std::string &pair_type = pair.GetInfo().type_;
+    if (!type || *type != pair_type) {
+      type = &pair_type;
+      kind = find_kind(pair_type);
+    }
+    if (!kind) {
+      continue;
     }
+    DifferenceRecord &record = result.emplace_back(
+        DifferenceRecord{pair.left_, pair.right_, 0, *kind});
+    std::string_view value1 = GetValue(pair.left_);
+    std::string_view value2 = GetValue(pair.right_);
+    if (record.kind_ == ValueKind::String) {
+      record.mask_ = GetDifferenceMask(record.kind_, value1, value2);
+    } else {
+      numeric.emplace_back(static_cast<uint32_t>(result.size() - 1));
+      record.left_number_ = GetNumericValue(record.kind_, value1);
+      record.right_number_ = GetNumericValue(record.kind_, value2);
+      left.emplace_back(record.left_number_);
+      right.emplace_back(record.right_number_);
+    }
+  }
+
+  std::vector<uint32_t> masks(numeric.size());
+  for (auto lane : XorColumns(left, right, masks)) {
+    result[numeric[lane]].mask_ = masks[lane];
   }
+  return result;
+}
+} // namespace
+
+VectorDifferenceRecord MakeDifferences(const VectorParameterPair &pairs,
+                                       const ValueKindMap &kinds) {
+  return MakeDifferencesBy(
+      pairs, [&kinds](const std::string &type) -> std::optional<ValueKind> {
+        if (auto it = kinds.find(type); it != kinds.end()) {
+          return it->second;
+        }
+        return std::nullopt;
+      });
+}
+
+VectorDifferenceRecord MakeDifferences(const VectorParameterPair &pairs,
+                                       ValueKindLookup kinds) {
+  return MakeDifferencesBy(pairs, kinds);
+}
+
+DifferenceDetails GetDetails(const DifferenceRecord &record) {
+  const ParameterInfo &info = record.GetInfo();
+  return GetDetails(record.kind_, info.type_, info.id_, record.mask_);
+}
+
+void AppendDetails(std::string &out, const DifferenceRecord &record) {
+  const ParameterInfo &info = record.GetInfo();
+  AppendDetails(out, record.kind_, info.type_, info.id_, record.mask_);
 }
 
-void StringDifference::Init(const DifferenceInfo &info) {
-  using namespace std::string_literals;
+size_t GetDetailCount(const DifferenceRecord &record) {
+  return GetDetailCount(record.kind_, record.mask_);
+}
+
+std::vector<int> GetBitsNumbers(uint32_t n, int bits) {
+  std::vector<int> result;
+  result.reserve(bits);
+  for (int i = 0; i < bits && n; ++i, n >>= 1) {
+    if (n & 1) {
+      result.emplace_back(i + 1);
+    }
+  }
+  return result;
+}
 
-  StringSoftParameter param1(info.value1_);
-  StringSoftParameter param2(info.value2_);
-  bool diff = param1.GetValue() != param2.GetValue();
-  if (diff) {
-    details_.resize(0);
-    details_ = {"Strings are different."s};
+std::span<const std::string> MaskDifference::GetDetailsView() const {
+  if (!details_) {
+    details_ = sft::GetDetails(kind_, type_, id_, mask_);
   }
+  return *details_;
+}
+
+void MaskDifference::Init(const DifferenceInfo &info) {
+  type_ = info.type_;
+  id_ = info.id_;
+  mask_ = GetDifferenceMask(kind_, info.value1_, info.value2_);
+  details_.reset();
+}
+
+void MaskDifference::Init(DifferenceInfo &&info) {
+  type_ = std::move(info.type_);
+  id_ = info.id_;
+  mask_ = GetDifferenceMask(kind_, info.value1_, info.value2_);
+  details_.reset();
 }
 
 } // namespace sft
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <bit>
 #include <cstdint>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <set>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "params.h"
@@ -24,6 +29,106 @@ using KeysVector = std::vector<KeyTypeId>;
 KeysVector CreateCommonIndex(const sft::VectorParameterInfo &v1,
                              const sft::VectorParameterInfo &v2);
 
+// Parameter with the same key in two tables, nullptr if the key is missing.
+struct ParameterPair {
+  const ParameterInfo *left_ = nullptr;
+  const ParameterInfo *right_ = nullptr;
+
+  const ParameterInfo &GetInfo() const { return left_ ? *left_ : *right_; }
+};
+
+using VectorParameterPair = std::vector<ParameterPair>;
+
+int CompareKeys(const ParameterInfo &a, const ParameterInfo &b);
+
+// Three-way order of parameters, CompareKeys or another order in which the
+// records of one key are next to each other.
+using KeyOrder = int (*)(const ParameterInfo &a, const ParameterInfo &b);
+
+// Stable sort by (type_, id_), repeated keys keep their order in the file.
+void SortByKey(VectorParameterInfo &v);
+
+// Walks two tables sorted by (type_, id_) once and calls f for every key
+// that is present in one table only or has different values. Repeated keys
+// are compared by their first entry, like a lookup with binary_find.
+template <typename F>
+void MergeJoin(std::span<const ParameterInfo> v1,
+               std::span<const ParameterInfo> v2, F &&f) {
+  auto skip_key = [](auto it, auto end) {
+    auto first = it;
+    while (++it != end && CompareKeys(*first, *it) == 0) {
+    }
+    return it;
+  };
+
+  auto it1 = v1.begin(), end1 = v1.end();
+  auto it2 = v2.begin(), end2 = v2.end();
+  while (it1 != end1 || it2 != end2) {
+    int order = it1 == end1 ? 1 : it2 == end2 ? -1 : CompareKeys(*it1, *it2);
+    if (order < 0) {
+      f(ParameterPair{&*it1, nullptr});
+      it1 = skip_key(it1, end1);
+    } else if (order > 0) {
+      f(ParameterPair{nullptr, &*it2});
+      it2 = skip_key(it2, end2);
+    } else {
+      if (it1->value_ != it2->value_) {
+        f(ParameterPair{&*it1, &*it2});
+      }
+      it1 = skip_key(it1, end1);
+      it2 = skip_key(it2, end2);
+    }
+  }
+}
+
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const VectorParameterInfo &v2);
+
+// Parameter of the key in a table sorted by (type_, id_), nullptr if the
+// key is missing.
+const ParameterInfo *FindParameter(std::span<const ParameterInfo> v,
+                                   const KeyTypeId &key);
+
+// Same as GetDifferentParameters limited to the given keys, for tables
+// without repeated keys.
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const VectorParameterInfo &v2,
+                                           std::span<const KeyTypeId> keys);
+
+// Size of CreateCommonIndex for two tables sorted by (type_, id_), counted
+// without building the index.
+size_t CountCommonKeys(std::span<const ParameterInfo> v1,
+                       std::span<const ParameterInfo> v2);
+
+// Hash of the records of one type, [begin_, end_) is its section in the
+// sorted table.
+struct TypeFingerprint {
+  std::string type_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  uint64_t hash_ = 0;
+};
+
+struct TableFingerprint {
+  uint64_t hash_ = 0;
+  std::vector<TypeFingerprint> types_;
+};
+
+// Sorts the table by key, drops repeated keys keeping the first one (the one
+// every comparison uses) and fingerprints the types in the same pass. The
+// keys that were repeated are added to repeated when it is not null.
+TableFingerprint SortTable(VectorParameterInfo &v,
+                           KeysVector *repeated = nullptr);
+// Fingerprint of a table that is already sorted and has no repeated keys.
+TableFingerprint GetFingerprint(const VectorParameterInfo &v);
+
+// Same result as GetDifferentParameters; type sections with equal
+// fingerprints are skipped without looking at their records.
+VectorParameterPair GetDifferentParameters(const VectorParameterInfo &v1,
+                                           const TableFingerprint &f1,
+                                           const VectorParameterInfo &v2,
+                                           const TableFingerprint &f2);
+
 struct DifferenceInfo {
   std::string type_;
   uint32_t id_ = 0;
@@ -35,8 +140,14 @@ using DifferenceDetails = std::vector<std::string>;
 
 class IDifference {
 public:
-  virtual DifferenceDetails GetDetails() const = 0;
+  // Valid while the object lives.
+  virtual std::span<const std::string> GetDetailsView() const = 0;
   virtual bool IsSignificant() const = 0;
+  // Copy of GetDetailsView, kept for old callers.
+  DifferenceDetails GetDetails() const {
+    auto details = GetDetailsView();
+    return {details.begin(), details.end()};
+  }
 
   virtual ~IDifference() = default;
 
@@ -45,52 +156,149 @@ private:
 
 std::vector<int> GetBitsNumbers(uint32_t n, int bits = 8);
 
-class BitDifference : public IDifference {
-public:
-  explicit BitDifference(const DifferenceInfo &data) { Init(data); }
-  DifferenceDetails GetDetails() const override { return details_; };
-  bool IsSignificant() const override { return !details_.empty(); };
+using ValueKindMap = std::map<std::string, ValueKind>;
 
-  void Init(const DifferenceInfo &info);
+// XOR of the two values for numeric kinds, 1 for different strings. A
+// missing or malformed value counts as 0 or an empty string.
+uint32_t GetDifferenceMask(ValueKind kind, std::string_view value1,
+                           std::string_view value2);
 
-private:
-  DifferenceDetails details_;
-};
+// Bulk XOR of two columns of numeric values, lane i of both columns holds
+// the same key: out[i] = left[i] ^ right[i]. Returns the indexes of the
+// lanes that differ. The columns are processed 16 or 32 bytes at a time
+// with SSE2/AVX2 where available. All spans must have the same size.
+std::vector<uint32_t> XorColumns(std::span<const uint8_t> left,
+                                 std::span<const uint8_t> right,
+                                 std::span<uint8_t> out);
+std::vector<uint32_t> XorColumns(std::span<const uint32_t> left,
+                                 std::span<const uint32_t> right,
+                                 std::span<uint32_t> out);
 
-class ByteDifference : public IDifference {
-public:
-  explicit ByteDifference(const DifferenceInfo &data) { Init(data); }
-  DifferenceDetails GetDetails() const override { return details_; };
-  bool IsSignificant() const override { return !details_.empty(); };
+// Portable implementations with the same result.
+std::vector<uint32_t> XorColumnsScalar(std::span<const uint8_t> left,
+                                       std::span<const uint8_t> right,
+                                       std::span<uint8_t> out);
+std::vector<uint32_t> XorColumnsScalar(std::span<const uint32_t> left,
+                                       std::span<const uint32_t> right,
+                                       std::span<uint32_t> out);
 
-  void Init(const DifferenceInfo &info);
+// Calls f(bit) for every set bit of mask, numbered from 1 as in
+// GetBitsNumbers.
+template <typename F> void ForEachBit(uint32_t mask, F &&f) {
+  for (; mask; mask &= mask - 1) {
+    f(std::countr_zero(mask) + 1);
+  }
+}
 
-private:
-  DifferenceDetails details_;
+DifferenceDetails GetDetails(ValueKind kind, std::string_view type,
+                             uint32_t id, uint32_t mask);
+
+// Appends the details to out, one line per changed bit ended by '\n', with
+// no intermediate strings.
+void AppendDetails(std::string &out, ValueKind kind, std::string_view type,
+                   uint32_t id, uint32_t mask);
+
+// Number of detail lines, without rendering them.
+size_t GetDetailCount(ValueKind kind, uint32_t mask);
+
+// Difference of one key stored by value. It points to the compared
+// parameters, so it is valid as long as their tables are.
+struct DifferenceRecord {
+  const ParameterInfo *left_ = nullptr;
+  const ParameterInfo *right_ = nullptr;
+  uint32_t mask_ = 0;
+  ValueKind kind_ = ValueKind::String;
+  // values of a numeric kind as parsed for the mask, 0 for strings
+  uint32_t left_number_ = 0;
+  uint32_t right_number_ = 0;
+
+  bool IsSignificant() const { return mask_ != 0; }
+  const ParameterInfo &GetInfo() const { return left_ ? *left_ : *right_; }
+  // Value of side 0 (left) or 1 (right) without parsing it again. The side
+  // must exist.
+  ParameterValue GetValue(size_t side) const {
+    if (kind_ == ValueKind::String) {
+      return ParameterValue(kind_, (side ? right_ : left_)->value_);
+    }
+    return ParameterValue::FromNumber(kind_,
+                                      side ? right_number_ : left_number_);
+  }
 };
 
-class DwordDifference : public IDifference {
+using VectorDifferenceRecord = std::vector<DifferenceRecord>;
+
+DifferenceRecord MakeDifference(ValueKind kind, const ParameterPair &pair);
+
+// One record per pair, in the order of pairs. Pairs of types missing in
+// kinds are skipped. Numeric values are gathered in columns and compared
+// with XorColumns.
+VectorDifferenceRecord MakeDifferences(const VectorParameterPair &pairs,
+                                       const ValueKindMap &kinds);
+
+// Kind of a type, nullopt for an unknown type.
+using ValueKindLookup = std::optional<ValueKind> (*)(std::string_view type);
+VectorDifferenceRecord MakeDifferences(const VectorParameterPair &pairs,
+                                       ValueKindLookup kinds);
+
+DifferenceDetails GetDetails(const DifferenceRecord &record);
+void AppendDetails(std::string &out, const DifferenceRecord &record);
+size_t GetDetailCount(const DifferenceRecord &record);
+
+// Keeps the key and the XOR mask, the details are rendered on the first
+// request and kept, so one object must not be read by several threads.
+class MaskDifference : public IDifference {
 public:
-  explicit DwordDifference(const DifferenceInfo &data) { Init(data); }
-  DifferenceDetails GetDetails() const override { return details_; };
-  bool IsSignificant() const override { return !details_.empty(); };
+  MaskDifference(ValueKind kind, const DifferenceInfo &data) : kind_(kind) {
+    Init(data);
+  }
+  MaskDifference(ValueKind kind, DifferenceInfo &&data) : kind_(kind) {
+    Init(std::move(data));
+  }
+  std::span<const std::string> GetDetailsView() const override;
+  bool IsSignificant() const override { return mask_ != 0; };
+  uint32_t GetMask() const { return mask_; }
 
   void Init(const DifferenceInfo &info);
+  void Init(DifferenceInfo &&info);
 
 private:
-  DifferenceDetails details_;
+  ValueKind kind_;
+  std::string type_;
+  uint32_t id_ = 0;
+  uint32_t mask_ = 0;
+  mutable std::optional<DifferenceDetails> details_;
 };
 
-class StringDifference : public IDifference {
+class BitDifference : public MaskDifference {
 public:
-  explicit StringDifference(const DifferenceInfo &data) { Init(data); }
-  DifferenceDetails GetDetails() const override { return details_; };
-  bool IsSignificant() const override { return !details_.empty(); };
+  explicit BitDifference(const DifferenceInfo &data)
+      : MaskDifference(ValueKind::Bit, data) {}
+  explicit BitDifference(DifferenceInfo &&data)
+      : MaskDifference(ValueKind::Bit, std::move(data)) {}
+};
 
-  void Init(const DifferenceInfo &info);
+class ByteDifference : public MaskDifference {
+public:
+  explicit ByteDifference(const DifferenceInfo &data)
+      : MaskDifference(ValueKind::Byte, data) {}
+  explicit ByteDifference(DifferenceInfo &&data)
+      : MaskDifference(ValueKind::Byte, std::move(data)) {}
+};
 
-private:
-  DifferenceDetails details_;
+class DwordDifference : public MaskDifference {
+public:
+  explicit DwordDifference(const DifferenceInfo &data)
+      : MaskDifference(ValueKind::Dword, data) {}
+  explicit DwordDifference(DifferenceInfo &&data)
+      : MaskDifference(ValueKind::Dword, std::move(data)) {}
+};
+
+class StringDifference : public MaskDifference {
+public:
+  explicit StringDifference(const DifferenceInfo &data)
+      : MaskDifference(ValueKind::String, data) {}
+  explicit StringDifference(DifferenceInfo &&data)
+      : MaskDifference(ValueKind::String, std::move(data)) {}
 };
 
 } // namespace sft
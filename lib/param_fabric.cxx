@@ -30,17 +30,13 @@ std::unique_ptr<SoftParameter>
 FabricParameter(const mml::MapStringString &description,
                 const std::string &type_name, const FabricMap &fabric_map,
                 const std::string &value_field) {
-  std::string value;
-
-  if (auto search = description.data_.find(value_field);
-      search != description.data_.end()) {
-    value = search->second;
-  } else {
+  auto search = description.data_.find(value_field);
+  if (search == description.data_.end()) {
     return nullptr;
   }
 
   if (auto it = fabric_map.find(type_name); it != fabric_map.end()) {
-    return it->second(value);
+    return it->second(search->second);
   }
   return nullptr;
 }
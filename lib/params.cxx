@@ -1,9 +1,11 @@
 #include <algorithm>
 #include <bitset>
+#include <charconv>
 #include <cstdint>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 #include "format_utils.h"
@@ -12,6 +14,62 @@
 
 namespace sft {
 
+using namespace std::string_literals;
+
+uint32_t GetNumericValue(ValueKind kind, std::string_view value) {
+  auto parse = [](std::string_view value, uint32_t mask) -> uint32_t {
+    if (auto a = util::to_int<uint32_t>(value); a && *a <= mask) {
+      return *a;
+    }
+    return 0;
+  };
+
+  switch (kind) {
+  case ValueKind::Bit:
+    return parse(value, 0xffu) & 0x1u;
+  case ValueKind::Byte:
+    return parse(value, 0xffu);
+  case ValueKind::Dword:
+    return parse(value, 0xffffffffu);
+  case ValueKind::String:
+    break;
+  }
+  return 0;
+}
+
+ValueText::ValueText(ValueKind kind, std::string_view value)
+    : ValueText(ParameterValue(kind, value)) {}
+
+ValueText::ValueText(const ParameterValue &value) {
+  const ValueKind kind = value.GetKind();
+  if (kind == ValueKind::String) {
+    short_ = long_ = value.GetText();
+    return;
+  }
+  uint32_t number = value.GetNumber();
+  auto [end, ec] = std::to_chars(std::begin(short_buffer_),
+                                 std::end(short_buffer_), number);
+  short_ = std::string_view(short_buffer_, end);
+  if (kind == ValueKind::Bit) {
+    long_ = short_;
+    return;
+  }
+  char *long_end = fmt::format_bits(long_buffer_, number,
+                                    kind == ValueKind::Byte ? 8 : 32, 4);
+  long_ = std::string_view(long_buffer_, long_end);
+}
+
+namespace {
+// Field name of a type without copying it, empty for an unknown type.
+std::string_view GetFieldName(const mml::MapStringString &dict,
+                              const std::string &type) {
+  if (auto it = dict.data_.find(type); it != dict.data_.end()) {
+    return it->second;
+  }
+  return {};
+}
+} // namespace
+
 ParameterInfo GetParameterInfo(const mml::MapStringString &description,
                                const mml::ConvertInfo &ci) {
   ParameterInfo param;
@@ -26,6 +84,25 @@ ParameterInfo GetParameterInfo(const mml::MapStringString &description,
   return param;
 }
 
+ParameterInfo GetParameterInfo(const mml::RecordView &description,
+                               const mml::ConvertInfo &ci) {
+  ParameterInfo param;
+
+  param.type_ = GetItemByKey(description, ci.type_key_);
+  std::string_view value_name = GetFieldName(ci.type_to_value_, param.type_);
+  std::string_view number_name = GetFieldName(ci.type_to_number_, param.type_);
+  std::string_view number = GetItemByKey(description, number_name);
+  if (auto id = util::to_int<uint32_t>(number); id) {
+    param.id_ = *id;
+  } else {
+    throw std::invalid_argument("Wrong number '"s + std::string(number) +
+                                "' for type '"s + param.type_ + "'."s);
+  }
+  param.value_ = GetItemByKey(description, value_name);
+
+  return param;
+}
+
 VectorParameterInfo Convert(const mml::VectorMapStringString &mml_dict,
                             const mml::ConvertInfo &ci) {
   VectorParameterInfo vpi;
@@ -40,13 +117,28 @@ VectorParameterInfo Convert(const mml::VectorMapStringString &mml_dict,
   return vpi;
 }
 
+VectorParameterInfo Convert(const mml::VectorRecordView &records,
+                            const mml::ConvertInfo &ci) {
+  VectorParameterInfo vpi;
+  vpi.reserve(records.data_.size());
+
+  std::ranges::transform(records.data_, std::back_inserter(vpi),
+                         [&ci](const mml::RecordView &item) {
+                           return GetParameterInfo(item, ci);
+                         });
+
+  return vpi;
+}
+
 VectorParameterInfo Load(const std::string &file, const std::string &prefix,
                          const mml::ConvertInfo &ci) {
+  mml::LoadedFile loaded(file, prefix);
+  return Load(loaded, prefix, ci);
+}
 
-  mml::VectorMapStringString params = mml::Load(file, prefix);
-
-  VectorParameterInfo vpi;
-  return Convert(params, ci);
+VectorParameterInfo Load(const mml::LoadedFile &file, std::string_view prefix,
+                         const mml::ConvertInfo &ci) {
+  return Convert(file.GetRecords(prefix), ci);
 }
 
 std::string BitSoftParameter::GetShortValue() const {
@@ -79,8 +171,12 @@ std::unique_ptr<SoftParameter> DwordSoftParameter::GetEmpty() const {
   return std::make_unique<DwordSoftParameter>(0);
 }
 
-std::string StringSoftParameter::GetShortValue() const { return GetData(); }
-std::string StringSoftParameter::GetLongValue() const { return GetData(); }
+std::string StringSoftParameter::GetShortValue() const {
+  return std::string(GetDataView());
+}
+std::string StringSoftParameter::GetLongValue() const {
+  return std::string(GetDataView());
+}
 std::unique_ptr<SoftParameter> StringSoftParameter::GetEmpty() const {
   return std::make_unique<StringSoftParameter>(std::string{});
 }
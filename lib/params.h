@@ -5,6 +5,8 @@
 #include <memory>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "charconv_util.h"
@@ -21,13 +23,84 @@ struct ParameterInfo {
 ParameterInfo GetParameterInfo(const mml::MapStringString &description,
                                const mml::ConvertInfo &ci);
 
+ParameterInfo GetParameterInfo(const mml::RecordView &description,
+                               const mml::ConvertInfo &ci);
+
 using VectorParameterInfo = std::vector<ParameterInfo>;
 
+enum class ValueKind : uint8_t { Bit, Byte, Dword, String };
+
+// Value of a numeric kind as compared: the low bit for Bit, 0 for a
+// missing, malformed or out of range value.
+uint32_t GetNumericValue(ValueKind kind, std::string_view value);
+
+// Value of one parameter as a tagged union: the parsed number of a numeric
+// kind or the text of a string, which refers to the source value. Built on
+// the stack when a row is rendered.
+class ParameterValue {
+public:
+  ParameterValue(ValueKind kind, std::string_view value) : kind_(kind) {
+    if (kind == ValueKind::String) {
+      text_ = value;
+    } else {
+      number_ = GetNumericValue(kind, value);
+    }
+  }
+  // A number already parsed with GetNumericValue.
+  static ParameterValue FromNumber(ValueKind kind, uint32_t number) {
+    ParameterValue result(kind, std::string_view());
+    if (kind != ValueKind::String) {
+      result.number_ = number;
+    }
+    return result;
+  }
+
+  ValueKind GetKind() const { return kind_; }
+  // 0 for a string.
+  uint32_t GetNumber() const {
+    return kind_ == ValueKind::String ? 0 : number_;
+  }
+  // Empty for a number.
+  std::string_view GetText() const {
+    return kind_ == ValueKind::String ? text_ : std::string_view();
+  }
+
+private:
+  ValueKind kind_;
+  union {
+    uint32_t number_ = 0;
+    std::string_view text_;
+  };
+};
+
+// Short and long text of a value as printed in reports. Numbers are written
+// into the object itself, strings refer to the source value.
+class ValueText {
+public:
+  ValueText(ValueKind kind, std::string_view value);
+  explicit ValueText(const ParameterValue &value);
+  ValueText(const ValueText &) = delete;
+  ValueText &operator=(const ValueText &) = delete;
+
+  std::string_view GetShortValue() const { return short_; }
+  std::string_view GetLongValue() const { return long_; }
+
+private:
+  char short_buffer_[12];
+  char long_buffer_[40];
+  std::string_view short_;
+  std::string_view long_;
+};
+
 VectorParameterInfo Convert(const mml::VectorMapStringString &mml_dict,
                             const mml::ConvertInfo &ci);
+VectorParameterInfo Convert(const mml::VectorRecordView &records,
+                            const mml::ConvertInfo &ci);
 
 VectorParameterInfo Load(const std::string &file, const std::string &prefix,
                          const mml::ConvertInfo &ci);
+VectorParameterInfo Load(const mml::LoadedFile &file, std::string_view prefix,
+                         const mml::ConvertInfo &ci);
 
 template <std::forward_iterator I, std::sentinel_for<I> S, class T,
           class Proj = std::identity,
@@ -41,11 +114,15 @@ constexpr I binary_find(I first, S last, const T &value, Comp comp = {},
 
 class SoftParameter {
 public:
-  explicit SoftParameter(std::string_view data) : data_(std::string(data)) {}
+  explicit SoftParameter(std::string data) : data_(std::move(data)) {}
+  explicit SoftParameter(std::string_view data) : data_(data) {}
   virtual std::string GetShortValue() const = 0;
   virtual std::string GetLongValue() const = 0;
   virtual std::unique_ptr<SoftParameter> GetEmpty() const = 0;
-  ~SoftParameter() = default;
+  virtual ~SoftParameter() = default;
+  // Source text of the value, valid while the object lives.
+  std::string_view GetDataView() const { return data_; }
+  // Copy of GetDataView, kept for old callers.
   std::string GetData() const { return data_; }
 
 private:
@@ -65,7 +142,7 @@ public:
   std::string GetShortValue() const override;
   std::string GetLongValue() const override;
   std::unique_ptr<SoftParameter> GetEmpty() const override;
-  uint8_t GetValue() { return value_; }
+  uint8_t GetValue() const { return value_; }
 
 private:
   uint8_t value_ = 0;
@@ -85,7 +162,7 @@ public:
   std::string GetLongValue() const override;
   std::unique_ptr<SoftParameter> GetEmpty() const override;
 
-  uint8_t GetValue() { return value_; }
+  uint8_t GetValue() const { return value_; }
 
 private:
   uint8_t value_ = 0;
@@ -105,7 +182,7 @@ public:
   std::string GetLongValue() const override;
   std::unique_ptr<SoftParameter> GetEmpty() const override;
 
-  uint32_t GetValue() { return value_; }
+  uint32_t GetValue() const { return value_; }
 
 private:
   uint32_t value_ = 0;
@@ -113,14 +190,14 @@ private:
 
 class StringSoftParameter : public SoftParameter {
 public:
-  explicit StringSoftParameter(const std::string &value)
-      : SoftParameter(value) {}
+  explicit StringSoftParameter(std::string value)
+      : SoftParameter(std::move(value)) {}
   explicit StringSoftParameter(std::string_view value) : SoftParameter(value) {}
   std::string GetShortValue() const override;
   std::string GetLongValue() const override;
   std::unique_ptr<SoftParameter> GetEmpty() const override;
 
-  std::string GetValue() { return GetData(); }
+  std::string GetValue() const { return GetData(); }
 };
 
 } // namespace sft
@@ -0,0 +1,182 @@
+#include <charconv>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "params.h"
+#include "report.h"
+
+namespace sft {
+
+namespace {
+void AppendNumber(std::string &out, uint32_t n) {
+  char buffer[16];
+  auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), n);
+  out.append(buffer, end);
+}
+
+void AppendJsonString(std::string &out, std::string_view s) {
+  const char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  for (char ch : s) {
+    auto c = static_cast<unsigned char>(ch);
+    if (ch == '"' || ch == '\\') {
+      out.push_back('\\');
+      out.push_back(ch);
+    } else if (c < 0x20) {
+      out.append("\\u00");
+      out.push_back(kHex[c >> 4]);
+      out.push_back(kHex[c & 0xf]);
+    } else {
+      out.push_back(ch);
+    }
+  }
+  out.push_back('"');
+}
+
+void AppendCsvField(std::string &out, std::string_view s) {
+  if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+    out.append(s);
+    return;
+  }
+  out.push_back('"');
+  for (char ch : s) {
+    if (ch == '"') {
+      out.push_back('"');
+    }
+    out.push_back(ch);
+  }
+  out.push_back('"');
+}
+
+// Calls f(bit) for the changed bits of numeric kinds.
+template <typename F>
+void ForEachChangedBit(const DifferenceRecord &record, F &&f) {
+  if (record.kind_ != ValueKind::String) {
+    ForEachBit(record.mask_, f);
+  }
+}
+} // namespace
+
+BufferedWriter::BufferedWriter(std::ostream &out, size_t block_size)
+    : out_(out), block_size_(block_size) {
+  buffer_.reserve(block_size_ + block_size_ / 4);
+}
+
+BufferedWriter::~BufferedWriter() { Flush(); }
+
+void BufferedWriter::Flush() {
+  out_.write(buffer_.data(), buffer_.size());
+  written_ += buffer_.size();
+  buffer_.clear();
+}
+
+void NdjsonSink::BeginPair(std::string_view ne1, std::string_view ne2) {
+  ne1_ = ne1;
+  ne2_ = ne2;
+}
+
+void NdjsonSink::Add(const DifferenceRecord &record) {
+  std::string &out = out_.GetBuffer();
+  const ParameterInfo &info = record.GetInfo();
+
+  out.append("{\"ne1\":");
+  AppendJsonString(out, ne1_);
+  out.append(",\"ne2\":");
+  AppendJsonString(out, ne2_);
+  out.append(",\"type\":");
+  AppendJsonString(out, info.type_);
+  out.append(",\"id\":");
+  AppendNumber(out, info.id_);
+  const char *names[] = {",\"value1\":", ",\"value2\":"};
+  const ParameterInfo *params[] = {record.left_, record.right_};
+  for (size_t i = 0; i != 2; ++i) {
+    out.append(names[i]);
+    if (params[i]) {
+      ValueText text(record.GetValue(i));
+      AppendJsonString(out, text.GetShortValue());
+    } else {
+      out.append("null");
+    }
+  }
+  out.append(",\"bits\":[");
+  bool first = true;
+  ForEachChangedBit(record, [&out, &first](int bit) {
+    if (!first) {
+      out.push_back(',');
+    }
+    first = false;
+    AppendNumber(out, bit);
+  });
+  out.append("]}\n");
+  out_.Commit();
+}
+
+void CsvSink::Begin() {
+  out_.GetBuffer().append("ne1,ne2,type,id,value1,value2,bits\n");
+  out_.Commit();
+}
+
+void CsvSink::BeginPair(std::string_view ne1, std::string_view ne2) {
+  ne1_ = ne1;
+  ne2_ = ne2;
+}
+
+void CsvSink::Add(const DifferenceRecord &record) {
+  std::string &out = out_.GetBuffer();
+  const ParameterInfo &info = record.GetInfo();
+
+  AppendCsvField(out, ne1_);
+  out.push_back(',');
+  AppendCsvField(out, ne2_);
+  out.push_back(',');
+  AppendCsvField(out, info.type_);
+  out.push_back(',');
+  AppendNumber(out, info.id_);
+  const ParameterInfo *params[] = {record.left_, record.right_};
+  for (size_t i = 0; i != 2; ++i) {
+    out.push_back(',');
+    if (params[i]) {
+      ValueText text(record.GetValue(i));
+      AppendCsvField(out, text.GetShortValue());
+    }
+  }
+  out.push_back(',');
+  bool first = true;
+  ForEachChangedBit(record, [&out, &first](int bit) {
+    if (!first) {
+      out.push_back(' ');
+    }
+    first = false;
+    AppendNumber(out, bit);
+  });
+  out.push_back('\n');
+  out_.Commit();
+}
+
+void WriteWatchReport(BufferedWriter &out, IReportSink &sink, size_t number,
+                      std::string_view time, std::string_view ne1,
+                      std::string_view ne2,
+                      const VectorDifferenceRecord &records) {
+  std::string &text = out.GetBuffer();
+  text.append("=== Report ").append(std::to_string(number));
+  text.append(" at ").append(time).append(": ");
+  if (records.empty()) {
+    text.append("no differences");
+  } else {
+    text.append(std::to_string(records.size()));
+    text.append(records.size() == 1 ? " difference" : " differences");
+  }
+  text.append(" ===\n");
+  out.Commit();
+
+  sink.BeginPair(ne1, ne2);
+  for (const auto &record : records) {
+    sink.Add(record);
+  }
+  sink.EndPair();
+}
+
+} // namespace sft
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "param_compare.h"
+
+namespace sft {
+
+enum class ReportFormat { Table, Grouped, Ndjson, Csv };
+
+// Collects output in one block and writes it to out when the block is
+// full. The rest is written by Flush() or the destructor.
+class BufferedWriter {
+public:
+  static constexpr size_t kBlockSize = 1 << 20;
+
+  explicit BufferedWriter(std::ostream &out, size_t block_size = kBlockSize);
+  ~BufferedWriter();
+
+  BufferedWriter(const BufferedWriter &) = delete;
+  BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+  // Text is appended here, Commit() is called after each complete record.
+  std::string &GetBuffer() { return buffer_; }
+  void Commit() {
+    if (buffer_.size() >= block_size_) {
+      Flush();
+    }
+  }
+  void Flush();
+  // Bytes passed to the stream so far.
+  size_t GetWrittenBytes() const { return written_; }
+
+private:
+  std::ostream &out_;
+  size_t block_size_ = kBlockSize;
+  size_t written_ = 0;
+  std::string buffer_;
+};
+
+// Receives the differences of each compared pair of NEs in print order.
+class IReportSink {
+public:
+  // Called once at the start of the whole report.
+  virtual void Begin() {}
+  virtual void BeginPair(std::string_view ne1, std::string_view ne2) = 0;
+  virtual void Add(const DifferenceRecord &record) = 0;
+  virtual void EndPair() {}
+
+  virtual ~IReportSink() = default;
+};
+
+// One JSON object per difference and line: ne1, ne2, type, id, value1,
+// value2 and the list of changed bits. A missing value is null.
+class NdjsonSink : public IReportSink {
+public:
+  explicit NdjsonSink(BufferedWriter &out) : out_(out) {}
+
+  void BeginPair(std::string_view ne1, std::string_view ne2) override;
+  void Add(const DifferenceRecord &record) override;
+
+private:
+  BufferedWriter &out_;
+  std::string ne1_;
+  std::string ne2_;
+};
+
+// RFC 4180 rows with the same fields as NdjsonSink, the changed bits are
+// separated by spaces. Begin() writes the header row.
+class CsvSink : public IReportSink {
+public:
+  explicit CsvSink(BufferedWriter &out) : out_(out) {}
+
+  void Begin() override;
+  void BeginPair(std::string_view ne1, std::string_view ne2) override;
+  void Add(const DifferenceRecord &record) override;
+
+private:
+  BufferedWriter &out_;
+  std::string ne1_;
+  std::string ne2_;
+};
+
+// Writes report number of --watch: a line with the number, the time and
+// the count of differences, then the differences through sink. The line is
+// written for an empty report too, so the last report shown is current.
+void WriteWatchReport(BufferedWriter &out, IReportSink &sink, size_t number,
+                      std::string_view time, std::string_view ne1,
+                      std::string_view ne2,
+                      const VectorDifferenceRecord &records);
+
+} // namespace sft
@@ -0,0 +1,233 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SFT_USE_MKSTEMP 1
+#endif
+
+#include "hash_util.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+
+namespace sft {
+
+using namespace std::string_literals;
+
+namespace {
+constexpr char kMagic[8] = {'S', 'F', 'T', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrder = 0x01020304u;
+
+// File layout: header, records, string blob. Offsets are from the start of
+// the blob. Loading copies every record out of the mapping into the table,
+// there is no tokenizing or sorting.
+struct SnapshotHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t byte_order_;
+  uint64_t source_size_;
+  int64_t source_mtime_;
+  uint64_t source_hash_;
+  uint64_t settings_key_;
+  uint64_t count_;
+  uint64_t ne_offset_;
+  uint64_t ne_size_;
+  uint64_t strings_size_;
+};
+
+struct SnapshotRecord {
+  uint64_t type_offset_;
+  uint64_t value_offset_;
+  uint32_t type_size_;
+  uint32_t value_size_;
+  uint32_t id_;
+  uint32_t reserved_;
+};
+
+class StringBlob {
+public:
+  uint64_t Add(std::string_view s) {
+    uint64_t offset = data_.size();
+    data_.append(s);
+    return offset;
+  }
+  // Types repeat in every record, they are stored once.
+  uint64_t AddShared(const std::string &s) {
+    auto [it, inserted] = shared_.try_emplace(s, 0);
+    if (inserted) {
+      it->second = Add(s);
+    }
+    return it->second;
+  }
+  const std::string &GetData() const { return data_; }
+
+private:
+  std::string data_;
+  std::map<std::string, uint64_t> shared_;
+};
+
+// Creates an empty file with a unique name next to path. The name is
+// unique across processes sharing the directory.
+std::string CreateTempFile(const std::string &path) {
+#ifdef SFT_USE_MKSTEMP
+  std::string tmp_path = path + ".XXXXXX"s;
+  int fd = ::mkstemp(tmp_path.data());
+  if (fd < 0) {
+    throw std::runtime_error("Can't create a file next to '"s + path +
+                             "'."s);
+  }
+  // mkstemp creates the file private, snapshots are readable like before
+  ::fchmod(fd, 0644);
+  ::close(fd);
+  return tmp_path;
+#else
+  auto thread_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  return path + ".tmp"s + std::to_string(thread_hash);
+#endif
+}
+
+} // namespace
+
+SourceStamp GetSourceStamp(const std::string &filename, std::string_view data) {
+  SourceStamp stamp;
+  stamp.size_ = data.size();
+  stamp.mtime_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::filesystem::last_write_time(filename)
+                         .time_since_epoch())
+                     .count();
+  stamp.hash_ = util::Hash64(data);
+  return stamp;
+}
+
+std::string GetSnapshotPath(const std::string &cache_dir,
+                            const std::string &filename) {
+  auto source = std::filesystem::weakly_canonical(filename);
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.snap",
+                static_cast<unsigned long long>(
+                    util::Hash64(source.string())));
+  return (std::filesystem::path(cache_dir) / name).string();
+}
+
+void WriteSnapshot(const std::string &path, const SourceStamp &stamp,
+                   uint64_t settings_key, const VectorParameterInfo &data,
+                   std::string_view ne) {
+  StringBlob blob;
+  std::vector<SnapshotRecord> records;
+  records.reserve(data.size());
+  for (const auto &info : data) {
+    SnapshotRecord record{};
+    record.type_offset_ = blob.AddShared(info.type_);
+    record.type_size_ = static_cast<uint32_t>(info.type_.size());
+    record.value_offset_ = blob.Add(info.value_);
+    record.value_size_ = static_cast<uint32_t>(info.value_.size());
+    record.id_ = info.id_;
+    records.emplace_back(record);
+  }
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kVersion;
+  header.byte_order_ = kByteOrder;
+  header.source_size_ = stamp.size_;
+  header.source_mtime_ = stamp.mtime_;
+  header.source_hash_ = stamp.hash_;
+  header.settings_key_ = settings_key;
+  header.count_ = records.size();
+  header.ne_offset_ = blob.Add(ne);
+  header.ne_size_ = ne.size();
+  header.strings_size_ = blob.GetData().size();
+
+  // write next to the target and rename, readers never see a partial file
+  std::string tmp_path = CreateTempFile(path);
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              records.size() * sizeof(SnapshotRecord));
+    out.write(blob.GetData().data(), blob.GetData().size());
+    if (!out) {
+      std::filesystem::remove(tmp_path);
+      throw std::runtime_error("Can't write snapshot '"s + path + "'."s);
+    }
+  }
+  std::filesystem::rename(tmp_path, path);
+}
+
+std::optional<Snapshot> ReadSnapshot(const std::string &path,
+                                     const SourceStamp &stamp,
+                                     uint64_t settings_key) {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) {
+    return std::nullopt;
+  }
+  mml::MappedFile file;
+  try {
+    file = mml::MappedFile(path);
+  } catch (std::runtime_error &) {
+    return std::nullopt;
+  }
+  std::string_view data = file.GetData();
+
+  SnapshotHeader header;
+  if (data.size() < sizeof(header)) {
+    return std::nullopt;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic_, kMagic, sizeof(kMagic)) != 0 ||
+      header.version_ != kVersion || header.byte_order_ != kByteOrder ||
+      header.settings_key_ != settings_key ||
+      SourceStamp{header.source_size_, header.source_mtime_,
+                  header.source_hash_} != stamp) {
+    return std::nullopt;
+  }
+
+  const uint64_t records_size = header.count_ * sizeof(SnapshotRecord);
+  if (header.count_ > data.size() / sizeof(SnapshotRecord) ||
+      header.strings_size_ > data.size() ||
+      sizeof(header) + records_size + header.strings_size_ != data.size()) {
+    return std::nullopt;
+  }
+  const char *records = data.data() + sizeof(header);
+  std::string_view strings = data.substr(sizeof(header) + records_size);
+  auto get_string = [&strings](uint64_t offset, uint64_t size,
+                               std::string &s) {
+    if (offset > strings.size() || size > strings.size() - offset) {
+      return false;
+    }
+    s = strings.substr(offset, size);
+    return true;
+  };
+
+  Snapshot result;
+  if (!get_string(header.ne_offset_, header.ne_size_, result.ne_)) {
+    return std::nullopt;
+  }
+  result.data_.resize(header.count_);
+  for (uint64_t i = 0; i != header.count_; ++i) {
+    SnapshotRecord record;
+    std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+    ParameterInfo &info = result.data_[i];
+    info.id_ = record.id_;
+    if (!get_string(record.type_offset_, record.type_size_, info.type_) ||
+        !get_string(record.value_offset_, record.value_size_, info.value_)) {
+      return std::nullopt;
+    }
+  }
+  return result;
+}
+
+} // namespace sft
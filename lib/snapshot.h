@@ -0,0 +1,45 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "params.h"
+
+namespace sft {
+
+// Identity of a source dump, a snapshot is used only if all fields match.
+struct SourceStamp {
+  uint64_t size_ = 0;
+  int64_t mtime_ = 0;
+  uint64_t hash_ = 0;
+  auto operator<=>(const SourceStamp &) const = default;
+};
+
+SourceStamp GetSourceStamp(const std::string &filename, std::string_view data);
+
+struct Snapshot {
+  VectorParameterInfo data_;
+  std::string ne_;
+};
+
+// Name of the snapshot of filename inside cache_dir.
+std::string GetSnapshotPath(const std::string &cache_dir,
+                            const std::string &filename);
+
+// Writes the sorted table in a versioned binary format. settings_key
+// identifies the parse settings the table was produced with.
+void WriteSnapshot(const std::string &path, const SourceStamp &stamp,
+                   uint64_t settings_key, const VectorParameterInfo &data,
+                   std::string_view ne);
+
+// Maps the snapshot and copies its records into a table, one string per
+// type and value. Returns nothing if it is missing, corrupt, of another
+// version or made from another source or settings.
+std::optional<Snapshot> ReadSnapshot(const std::string &path,
+                                     const SourceStamp &stamp,
+                                     uint64_t settings_key);
+
+} // namespace sft
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <ostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define UTIL_HAS_RUSAGE 1
+#endif
+
+#include "stats.h"
+
+namespace util {
+
+namespace {
+template <typename T>
+void AddItem(std::vector<std::pair<std::string, T>> &items,
+             std::string_view name, T value) {
+  auto it = std::ranges::find(items, name, &std::pair<std::string, T>::first);
+  if (it == items.end()) {
+    items.emplace_back(std::string(name), value);
+  } else {
+    it->second += value;
+  }
+}
+
+double ToMilliseconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+} // namespace
+
+void Stats::AddTime(std::string_view stage, std::chrono::nanoseconds time) {
+  std::lock_guard lock(mutex_);
+  AddItem(times_, stage, time);
+}
+
+void Stats::Add(std::string_view counter, uint64_t value) {
+  std::lock_guard lock(mutex_);
+  AddItem(counters_, counter, value);
+}
+
+void Stats::Merge(const Stats &other, std::string_view suffix) {
+  std::scoped_lock lock(mutex_, other.mutex_);
+  for (const auto &[stage, time] : other.times_) {
+    AddItem(times_, stage + std::string(suffix), time);
+  }
+  for (const auto &[counter, value] : other.counters_) {
+    AddItem(counters_, counter, value);
+  }
+}
+
+void Stats::Print(std::ostream &out) const {
+  std::lock_guard lock(mutex_);
+  for (const auto &[stage, time] : times_) {
+    out << stage << ": " << ToMilliseconds(time) << " ms\n";
+  }
+  for (const auto &[counter, value] : counters_) {
+    out << counter << ": " << value << '\n';
+  }
+}
+
+// Names are identifiers chosen by the program, they need no escaping.
+void Stats::PrintJson(std::ostream &out) const {
+  std::lock_guard lock(mutex_);
+  out << "{\"stages_ms\":{";
+  for (size_t i = 0, is = times_.size(); i != is; ++i) {
+    out << (i ? "," : "") << '"' << times_[i].first
+        << "\":" << ToMilliseconds(times_[i].second);
+  }
+  out << "},\"counters\":{";
+  for (size_t i = 0, is = counters_.size(); i != is; ++i) {
+    out << (i ? "," : "") << '"' << counters_[i].first
+        << "\":" << counters_[i].second;
+  }
+  out << "}}\n";
+}
+
+StageTimer::StageTimer(Stats *stats, std::string_view stage)
+    : stats_(stats), stage_(stage) {
+  if (stats_) {
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+StageTimer::~StageTimer() {
+  if (stats_) {
+    stats_->AddTime(stage_, std::chrono::steady_clock::now() - start_);
+  }
+}
+
+uint64_t GetPeakRss() {
+#ifdef UTIL_HAS_RUSAGE
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return 0;
+}
+
+} // namespace util
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// Wall time of stages and counters of one run. Values with the same name
+// are summed, names keep the order in which they first appeared. Safe to
+// use from several threads.
+class Stats {
+public:
+  void AddTime(std::string_view stage, std::chrono::nanoseconds time);
+  void Add(std::string_view counter, uint64_t value);
+  // Adds the counters of other and its times with suffix appended to the
+  // stage names.
+  void Merge(const Stats &other, std::string_view suffix);
+
+  // One "name: value" line per item, times in milliseconds.
+  void Print(std::ostream &out) const;
+  // {"stages_ms":{...},"counters":{...}}
+  void PrintJson(std::ostream &out) const;
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<std::pair<std::string, std::chrono::nanoseconds>> times_;
+  std::vector<std::pair<std::string, uint64_t>> counters_;
+};
+
+// Adds the time between construction and destruction to stats. Does
+// nothing, not even reading the clock, when stats is null.
+class StageTimer {
+public:
+  StageTimer(Stats *stats, std::string_view stage);
+  ~StageTimer();
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+  Stats *stats_;
+  std::string_view stage_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Peak resident set size of the process in bytes, 0 where unknown.
+uint64_t GetPeakRss();
+
+} // namespace util
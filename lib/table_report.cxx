@@ -0,0 +1,115 @@
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "params.h"
+#include "table_report.h"
+
+namespace sft {
+
+using namespace std::string_literals;
+
+namespace {
+void AppendBanner(std::string &out, const std::array<std::string, 2> &ne) {
+  out.append("Difference: NE1 : ").append(ne[0]);
+  out.append(" NE2 : ").append(ne[1]).push_back('\n');
+}
+} // namespace
+
+TableInfo PrepareTableInfo() {
+  TableInfo info;
+  info.desc_ = {{13, "Name"s, tab::Adjust::Left},
+                {11, "Number"s, tab::Adjust::Right},
+                {12, "Value"s, tab::Adjust::Right},
+                {40, "Value(bin)"s, tab::Adjust::Right}};
+  info.top_line_ = tab::GetTopLine(info.desc_);
+  info.header_line_ = tab::GetHeaderLine(info.desc_);
+  info.sep_line_ = tab::GetRowSeparatorLine(info.desc_);
+  info.footer_line_ = tab::GetFooterLine(info.desc_);
+  info.head_lines_ =
+      info.top_line_ + '\n' + info.header_line_ + '\n' + info.sep_line_ + '\n';
+  info.empty_row_line_ =
+      tab::GetRowLine(info.desc_, tab::VectorString(info.desc_.size())) + '\n';
+  return info;
+}
+
+void AppendRows(std::string &out, const DifferenceRecord &record,
+                const TableInfo &ti) {
+  const ParameterInfo *infos[] = {record.left_, record.right_};
+  for (size_t side = 0; side != 2; ++side) {
+    const ParameterInfo *info = infos[side];
+    if (!info) {
+      out.append(ti.empty_row_line_);
+      continue;
+    }
+    char id_buffer[12];
+    auto [id_end, ec] = std::to_chars(std::begin(id_buffer),
+                                      std::end(id_buffer), info->id_);
+    ValueText text(record.GetValue(side));
+    const std::array<std::string_view, 4> row = {
+        info->type_, std::string_view(id_buffer, id_end),
+        text.GetShortValue(), text.GetLongValue()};
+    tab::AppendRowLine(out, ti.desc_, row);
+    out.push_back('\n');
+  }
+}
+
+void TableSink::BeginPair(std::string_view ne1, std::string_view ne2) {
+  ne_ = {std::string(ne1), std::string(ne2)};
+}
+
+void TableSink::Add(const DifferenceRecord &record) {
+  std::string &out = out_.GetBuffer();
+  AppendBanner(out, ne_);
+  out.append(ti_.head_lines_);
+  AppendRows(out, record, ti_);
+  out.append(ti_.footer_line_).push_back('\n');
+  AppendDetails(out, record);
+  out.push_back('\n');
+  out_.Commit();
+}
+
+void GroupedTableSink::BeginPair(std::string_view ne1, std::string_view ne2) {
+  ne_ = {std::string(ne1), std::string(ne2)};
+  type_.clear();
+  has_banner_ = false;
+}
+
+void GroupedTableSink::Add(const DifferenceRecord &record) {
+  std::string &out = out_.GetBuffer();
+  if (!has_banner_) {
+    AppendBanner(out, ne_);
+    has_banner_ = true;
+  }
+  const std::string &type = record.GetInfo().type_;
+  if (type != type_) {
+    EndType();
+    out.append(ti_.head_lines_);
+    type_ = type;
+  } else {
+    out.append(ti_.sep_line_).push_back('\n');
+  }
+  AppendRows(out, record, ti_);
+  AppendDetails(details_, record);
+  out_.Commit();
+}
+
+void GroupedTableSink::EndPair() {
+  EndType();
+  out_.Commit();
+}
+
+void GroupedTableSink::EndType() {
+  if (type_.empty()) {
+    return;
+  }
+  std::string &out = out_.GetBuffer();
+  out.append(ti_.footer_line_).push_back('\n');
+  out.append(details_).push_back('\n');
+  details_.clear();
+  type_.clear();
+}
+
+} // namespace sft
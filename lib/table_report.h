@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+#include "param_compare.h"
+#include "report.h"
+#include "tabulator.h"
+
+namespace sft {
+
+// Columns of the table reports and their fixed lines, built once.
+struct TableInfo {
+  tab::TableSchema desc_;
+  std::string top_line_;
+  std::string header_line_;
+  std::string sep_line_;
+  std::string footer_line_;
+  // top, header and separator lines, each ended by a new line
+  std::string head_lines_;
+  std::string empty_row_line_;
+};
+
+TableInfo PrepareTableInfo();
+
+// Appends the rows of both parameters of a difference to out.
+void AppendRows(std::string &out, const DifferenceRecord &record,
+                const TableInfo &ti);
+
+// Boxed text report with one table per difference.
+class TableSink : public IReportSink {
+public:
+  TableSink(BufferedWriter &out, const TableInfo &ti) : out_(out), ti_(ti) {}
+
+  void BeginPair(std::string_view ne1, std::string_view ne2) override;
+  void Add(const DifferenceRecord &record) override;
+
+private:
+  BufferedWriter &out_;
+  const TableInfo &ti_;
+  std::array<std::string, 2> ne_;
+};
+
+// Compact report: one banner per pair of NEs and one table per type with
+// the rows of all its differences. The details follow each table.
+class GroupedTableSink : public IReportSink {
+public:
+  GroupedTableSink(BufferedWriter &out, const TableInfo &ti)
+      : out_(out), ti_(ti) {}
+
+  void BeginPair(std::string_view ne1, std::string_view ne2) override;
+  void Add(const DifferenceRecord &record) override;
+  void EndPair() override;
+
+private:
+  void EndType();
+
+  BufferedWriter &out_;
+  const TableInfo &ti_;
+  std::array<std::string, 2> ne_;
+  std::string type_;
+  std::string details_;
+  bool has_banner_ = false;
+};
+
+} // namespace sft
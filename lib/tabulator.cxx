@@ -1,5 +1,4 @@
 #include <iomanip>
-#include <sstream>
 #include <string>
 #include <vector>
 
@@ -22,13 +21,48 @@ std::string GetTopLine(const TableSchema &table) {
   return result;
 }
 
-std::string GetHeaderLine(const TableSchema &table) {
-  std::ostringstream result;
-  result << chVLine;
+namespace {
+void AppendCell(std::string &out, std::string_view value, size_t width,
+                Adjust adjust) {
+  size_t fill = width > value.size() ? width - value.size() : 0;
+  if (adjust == Adjust::Right) {
+    out.append(fill, ' ');
+  }
+  out.append(value);
+  if (adjust == Adjust::Left) {
+    out.append(fill, ' ');
+  }
+  out.push_back(chVLine);
+}
+} // namespace
+
+void AppendHeaderLine(std::string &out, const TableSchema &table) {
+  out.push_back(chVLine);
+  for (const auto &column : table) {
+    AppendCell(out, column.name_, column.width_, Adjust::Right);
+  }
+}
+
+void AppendRowLine(std::string &out, const TableSchema &table,
+                   std::span<const std::string_view> info) {
+  if (table.size() != info.size()) {
+    return;
+  }
+  out.push_back(chVLine);
   for (size_t i = 0, is = table.size(); i != is; ++i) {
-    result << std::setw(table[i].width_) << table[i].name_ << chVLine;
+    if (info[i].size() <= table[i].width_) {
+      AppendCell(out, info[i], table[i].width_, table[i].adjust_);
+    } else {
+      out.append(table[i].width_, chSharp);
+      out.push_back(chVLine);
+    }
   }
-  return result.str();
+}
+
+std::string GetHeaderLine(const TableSchema &table) {
+  std::string result;
+  AppendHeaderLine(result, table);
+  return result;
 }
 
 std::string GetRowSeparatorLine(const TableSchema &table) {
@@ -36,20 +70,10 @@ std::string GetRowSeparatorLine(const TableSchema &table) {
 }
 
 std::string GetRowLine(const TableSchema &table, const VectorString &info) {
-  std::ostringstream result;
-  if (table.size() == info.size()) {
-    result << chVLine;
-    for (size_t i = 0, is = table.size(); i != is; ++i) {
-      result << table[i].adjust_;
-      if (info[i].size() <= table[i].width_) {
-        result << std::setw(table[i].width_) << info[i] << chVLine;
-      } else {
-        result << std::setw(table[i].width_)
-               << std::string(table[i].width_, chSharp) << chVLine;
-      }
-    }
-  }
-  return result.str();
+  std::vector<std::string_view> cells(info.begin(), info.end());
+  std::string result;
+  AppendRowLine(result, table, cells);
+  return result;
 }
 
 std::string GetFooterLine(const TableSchema &table) {
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tab {
@@ -22,6 +24,12 @@ std::string GetRowSeparatorLine(const TableSchema &table);
 std::string GetRowLine(const TableSchema &table, const VectorString &info);
 std::string GetFooterLine(const TableSchema &table);
 
+// Append the lines to out without the trailing new line. Cells are padded
+// in place, no intermediate strings are built.
+void AppendHeaderLine(std::string &out, const TableSchema &table);
+void AppendRowLine(std::string &out, const TableSchema &table,
+                   std::span<const std::string_view> info);
+
 std::ostream &operator<<(std::ostream &os, Adjust adjust);
 
 } // namespace tab
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#define UTIL_BLOCK_SIGNALS 1
+#endif
+
+#include "thread_pool.h"
+
+namespace util {
+
+namespace {
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+} // namespace
+
+size_t GetDefaultThreadCount() {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+  threads = std::max<size_t>(1, threads);
+  queues_.reserve(threads);
+  for (size_t i = 0; i != threads; ++i) {
+    queues_.emplace_back(std::make_unique<Queue>());
+  }
+  threads_.reserve(threads);
+#ifdef UTIL_BLOCK_SIGNALS
+  // workers inherit the mask, SIGINT and SIGTERM go to the other threads
+  sigset_t signals, previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+#endif
+  for (size_t i = 0; i != threads; ++i) {
+    threads_.emplace_back([this, i]() { Run(i); });
+  }
+#ifdef UTIL_BLOCK_SIGNALS
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+#endif
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(Task task) {
+  size_t index = 0;
+  {
+    std::lock_guard lock(mutex_);
+    ++pending_;
+    if (current_pool == this) {
+      index = current_index;
+    } else {
+      index = next_queue_;
+      next_queue_ = (next_queue_ + 1) % queues_.size();
+    }
+  }
+  {
+    std::lock_guard lock(queues_[index]->mutex_);
+    queues_[index]->tasks_.emplace_back(std::move(task));
+  }
+  {
+    std::lock_guard lock(mutex_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+bool ThreadPool::TryPop(size_t index, Task &task) {
+  for (size_t i = 0, is = queues_.size(); i != is; ++i) {
+    Queue &queue = *queues_[(index + i) % is];
+    std::lock_guard lock(queue.mutex_);
+    if (queue.tasks_.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      task = std::move(queue.tasks_.back());
+      queue.tasks_.pop_back();
+    } else {
+      task = std::move(queue.tasks_.front());
+      queue.tasks_.pop_front();
+    }
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::Run(size_t index) {
+  current_pool = this;
+  current_index = index;
+  while (true) {
+    Task task;
+    if (TryPop(index, task)) {
+      {
+        std::lock_guard lock(mutex_);
+        --queued_;
+      }
+      task();
+      std::lock_guard lock(mutex_);
+      if (--pending_ == 0) {
+        done_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock lock(mutex_);
+    wake_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ <= 0) {
+      return;
+    }
+  }
+}
+
+} // namespace util
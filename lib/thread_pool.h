@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace util {
+
+size_t GetDefaultThreadCount();
+
+// Fixed size pool with one task queue per worker. A worker takes its own
+// newest task first and steals the oldest task of another worker when its
+// queue is empty. Queued tasks are finished before the pool is destroyed.
+// The workers block SIGINT and SIGTERM.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(size_t threads = GetDefaultThreadCount());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  void Submit(Task task);
+
+  template <typename F>
+  auto Async(F f) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+    auto result = task->get_future();
+    Submit([task]() { (*task)(); });
+    return result;
+  }
+
+  // Blocks until every submitted task has finished.
+  void Wait();
+
+  size_t GetSize() const { return threads_.size(); }
+
+private:
+  struct Queue {
+    std::mutex mutex_;
+    std::deque<Task> tasks_;
+  };
+
+  bool TryPop(size_t index, Task &task);
+  void Run(size_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  long queued_ = 0;
+  size_t pending_ = 0;
+  size_t next_queue_ = 0;
+  bool stop_ = false;
+};
+
+} // namespace util
@@ -0,0 +1,83 @@
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "type_registry.h"
+
+namespace sft {
+
+static_assert(FindTypeCode("BIT") == 0);
+static_assert(FindTypeCode("STRING_EX_B") == kTypeRegistry.size() - 1);
+static_assert(FindTypeCode("BITS") == kUnknownType);
+static_assert(FindTypeCode("") == kUnknownType);
+
+std::optional<ValueKind> FindValueKind(std::string_view type) {
+  if (const TypeDescriptor *descriptor = FindType(type)) {
+    return descriptor->kind_;
+  }
+  return std::nullopt;
+}
+
+int ComparePrintOrder(const ParameterInfo &a, const ParameterInfo &b) {
+  if (a.type_ != b.type_) {
+    const TypeDescriptor *type_a = FindType(a.type_);
+    const TypeDescriptor *type_b = FindType(b.type_);
+    if (type_a && type_b) {
+      return type_a->print_rank_ < type_b->print_rank_ ? -1 : 1;
+    }
+    if (type_a || type_b) {
+      return type_a ? -1 : 1;
+    }
+  }
+  return CompareKeys(a, b);
+}
+
+mml::ConvertInfo GetConvertInfo(const std::string &type_key) {
+  mml::ConvertInfo result;
+  for (const auto &type : kTypeRegistry) {
+    std::string name(type.name_);
+    result.type_to_number_.data_[name] = type.number_field_;
+    result.type_to_value_.data_[name] = type.value_field_;
+  }
+  result.type_key_ = type_key;
+  return result;
+}
+
+const ValueKindMap &GetValueKindMap() {
+  static const ValueKindMap result = [] {
+    ValueKindMap kinds;
+    for (const auto &type : kTypeRegistry) {
+      kinds.emplace(type.name_, type.kind_);
+    }
+    return kinds;
+  }();
+  return result;
+}
+
+const FabricMap &GetFabricMap() {
+  static const FabricMap result = [] {
+    FabricMap fabric;
+    for (const auto &type : kTypeRegistry) {
+      fabric.emplace(type.name_, type.factory_);
+    }
+    return fabric;
+  }();
+  return result;
+}
+
+const FabricDifferenceMap &GetFabricDifferenceMap() {
+  static const FabricDifferenceMap result = [] {
+    const std::array<FabricDifferencePtr, 4> by_kind = {
+        CreateBitDifference, CreateByteDifference, CreateDwordDifference,
+        CreateStringDifference};
+    FabricDifferenceMap fabric;
+    for (const auto &type : kTypeRegistry) {
+      fabric.emplace(type.name_, by_kind[static_cast<size_t>(type.kind_)]);
+    }
+    return fabric;
+  }();
+  return result;
+}
+
+} // namespace sft
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "mml_utils.h"
+#include "param_compare.h"
+#include "param_fabric.h"
+#include "params.h"
+
+namespace sft {
+
+// Everything known about one parameter type of a dump.
+struct TypeDescriptor {
+  std::string_view name_;
+  std::string_view number_field_;
+  std::string_view value_field_;
+  // position of the type in reports
+  size_t print_rank_ = 0;
+  ValueKind kind_ = ValueKind::String;
+  // bits of a numeric value, 0 for strings
+  uint8_t value_width_ = 0;
+  FabricPtr factory_ = nullptr;
+};
+
+// Index of a type in kTypeRegistry.
+using TypeCode = uint8_t;
+inline constexpr TypeCode kUnknownType = 0xff;
+
+inline constexpr std::array<TypeDescriptor, 12> kTypeRegistry = {{
+    {"BIT", "BITNUM", "BITVALUE", 1, ValueKind::Bit, 1,
+     CreateBitSoftParameter},
+    {"BYTE", "BYTENUM", "BYTEVALUE", 2, ValueKind::Byte, 8,
+     CreateByteSoftParameter},
+    {"DWORD", "DWORDNUM", "DWORDVALUE", 3, ValueKind::Dword, 32,
+     CreateDwordSoftParameter},
+    {"STRING", "STRINGNUM", "STRINGVALUE", 4, ValueKind::String, 0,
+     CreateStringSoftParameter},
+    {"BIT_EX", "BITNUM", "BITVALUE", 5, ValueKind::Bit, 1,
+     CreateBitSoftParameter},
+    {"BYTE_EX", "BYTENUM", "BYTEVALUE", 6, ValueKind::Byte, 8,
+     CreateByteSoftParameter},
+    {"DWORD_EX", "DWORDNUM", "DWORDVALUE", 7, ValueKind::Dword, 32,
+     CreateDwordSoftParameter},
+    {"STRING_EX", "STRINGNUM", "STRINGVALUE", 8, ValueKind::String, 0,
+     CreateStringSoftParameter},
+    {"BIT_EX_B", "BITNUM", "BITVALUE", 9, ValueKind::Bit, 1,
+     CreateBitSoftParameter},
+    {"BYTE_EX_B", "BYTENUM", "BYTEVALUE", 10, ValueKind::Byte, 8,
+     CreateByteSoftParameter},
+    {"DWORD_EX_B", "DWORDNUM", "DWORDVALUE", 11, ValueKind::Dword, 32,
+     CreateDwordSoftParameter},
+    {"STRING_EX_B", "STRINGNUM", "STRINGVALUE", 12, ValueKind::String, 0,
+     CreateStringSoftParameter},
+}};
+
+namespace detail {
+inline constexpr size_t kTypeSlots = 32;
+
+// FNV-1a with a seed, folded so that the low bits depend on every byte.
+constexpr uint32_t HashTypeName(std::string_view name, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+// First seed that puts every registered name into its own slot.
+constexpr uint32_t FindTypeSeed() {
+  for (uint32_t seed = 0; seed != 1u << 16; ++seed) {
+    std::array<bool, kTypeSlots> used{};
+    bool unique = true;
+    for (const auto &type : kTypeRegistry) {
+      size_t slot = HashTypeName(type.name_, seed) % kTypeSlots;
+      unique = unique && !used[slot];
+      used[slot] = true;
+    }
+    if (unique) {
+      return seed;
+    }
+  }
+  throw std::logic_error("No perfect hash for the type registry.");
+}
+
+inline constexpr uint32_t kTypeSeed = FindTypeSeed();
+
+constexpr std::array<TypeCode, kTypeSlots> MakeTypeSlots() {
+  std::array<TypeCode, kTypeSlots> result{};
+  result.fill(kUnknownType);
+  for (size_t i = 0; i != kTypeRegistry.size(); ++i) {
+    result[HashTypeName(kTypeRegistry[i].name_, kTypeSeed) % kTypeSlots] =
+        static_cast<TypeCode>(i);
+  }
+  return result;
+}
+
+inline constexpr std::array<TypeCode, kTypeSlots> kTypeSlotCodes =
+    MakeTypeSlots();
+} // namespace detail
+
+// Code of the type named in the DT field, kUnknownType if it is not
+// registered. One hash and one string comparison.
+constexpr TypeCode FindTypeCode(std::string_view name) {
+  TypeCode code = detail::kTypeSlotCodes[detail::HashTypeName(
+                                             name, detail::kTypeSeed) %
+                                         detail::kTypeSlots];
+  return code != kUnknownType && kTypeRegistry[code].name_ == name
+             ? code
+             : kUnknownType;
+}
+
+constexpr const TypeDescriptor *FindType(std::string_view name) {
+  TypeCode code = FindTypeCode(name);
+  return code == kUnknownType ? nullptr : &kTypeRegistry[code];
+}
+
+std::optional<ValueKind> FindValueKind(std::string_view type);
+
+// Order of the reports: types by print rank, unknown types after them by
+// name, then ids. A KeyOrder for ExternalSorter.
+int ComparePrintOrder(const ParameterInfo &a, const ParameterInfo &b);
+
+// Tables of the registry for the interfaces that take maps. The maps are
+// built once and shared.
+mml::ConvertInfo GetConvertInfo(const std::string &type_key);
+const ValueKindMap &GetValueKindMap();
+const FabricMap &GetFabricMap();
+const FabricDifferenceMap &GetFabricDifferenceMap();
+
+} // namespace sft
@@ -0,0 +1,249 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define UTIL_USE_SOCKETS 1
+#endif
+
+#include "unix_socket.h"
+
+namespace util {
+
+using namespace std::string_literals;
+
+#ifdef UTIL_USE_SOCKETS
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+sockaddr_un GetAddress(const std::string &path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("Socket path '"s + path + "' is too long."s);
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+// Removes the socket file of a listener that is gone. Anything else at the
+// path is left alone.
+void RemoveStaleSocket(const std::string &path, const sockaddr_un &address) {
+  struct stat info;
+  if (::lstat(path.c_str(), &info) != 0) {
+    if (errno == ENOENT) {
+      return;
+    }
+    throw std::runtime_error("Can't check '"s + path + "'."s);
+  }
+  if (!S_ISSOCK(info.st_mode)) {
+    throw std::runtime_error("'"s + path + "' is not a socket."s);
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Can't create a socket."s);
+  }
+  int result = ::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                         sizeof(address));
+  int error = errno;
+  ::close(fd);
+  if (result == 0 || error != ECONNREFUSED) {
+    throw std::runtime_error("'"s + path + "' is already in use."s);
+  }
+  ::unlink(path.c_str());
+}
+} // namespace
+
+UnixListener::UnixListener(const std::string &path) : path_(path) {
+  sockaddr_un address = GetAddress(path_);
+  RemoveStaleSocket(path_, address);
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error("Can't create a socket."s);
+  }
+  if (::bind(fd_, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(fd_, SOMAXCONN) != 0) {
+    ::close(fd_);
+    throw std::runtime_error("Can't listen on '"s + path_ + "'."s);
+  }
+  if (::pipe(wake_) != 0) {
+    ::close(fd_);
+    ::unlink(path_.c_str());
+    throw std::runtime_error("Can't create a pipe."s);
+  }
+  // a full pipe must not block the signal handler
+  ::fcntl(wake_[1], F_SETFL, ::fcntl(wake_[1], F_GETFL) | O_NONBLOCK);
+}
+
+UnixListener::~UnixListener() {
+  ::close(wake_[0]);
+  ::close(wake_[1]);
+  ::close(fd_);
+  ::unlink(path_.c_str());
+}
+
+void UnixListener::Wake() {
+  int saved = errno;
+  [[maybe_unused]] ssize_t size = ::write(wake_[1], "", 1);
+  errno = saved;
+}
+
+int UnixListener::Accept() {
+  // a signal that came before poll started is seen through the pipe
+  pollfd poll_fds[2] = {{fd_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+  for (;;) {
+    if (::poll(poll_fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        return -1;
+      }
+      throw std::runtime_error("Can't wait for connections."s);
+    }
+    if (poll_fds[1].revents) {
+      return -1;
+    }
+    int client = ::accept(fd_, nullptr, nullptr);
+    if (client >= 0) {
+      return client;
+    }
+    if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN) {
+      throw std::runtime_error("Can't accept a connection."s);
+    }
+  }
+}
+
+int ConnectUnixSocket(const std::string &path) {
+  sockaddr_un address = GetAddress(path);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw std::runtime_error("Can't create a socket."s);
+  }
+  if (::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Can't connect to '"s + path + "'."s);
+  }
+  return fd;
+}
+
+SocketStreamBuf::SocketStreamBuf(int fd) : fd_(fd) {}
+
+SocketStreamBuf::~SocketStreamBuf() { ::close(fd_); }
+
+ReadStatus SocketStreamBuf::ReadLine(std::string &line,
+                                    std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  size_t end;
+  while ((end = input_.find('\n')) == std::string::npos) {
+    if (input_.size() > kMaxLine) {
+      throw std::length_error("Request line is too long."s);
+    }
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd poll_fd{fd_, POLLIN, 0};
+    int ready = ::poll(&poll_fd, 1,
+                       left.count() > 0 ? static_cast<int>(left.count()) : 0);
+    if (ready < 0 && errno != EINTR) {
+      throw std::runtime_error("Can't wait for the request."s);
+    }
+    if (ready == 0) {
+      return ReadStatus::Timeout;
+    }
+    if (ready < 0) {
+      continue;
+    }
+    char buffer[4096];
+    ssize_t size = ::recv(fd_, buffer, sizeof(buffer), 0);
+    if (size < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if (size <= 0) {
+      return ReadStatus::Closed;
+    }
+    input_.append(buffer, static_cast<size_t>(size));
+  }
+  line.assign(input_, 0, end);
+  input_.erase(0, end + 1);
+  return ReadStatus::Line;
+}
+
+void SocketStreamBuf::SetSendTimeout(std::chrono::milliseconds timeout) {
+  timeval value{};
+  value.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  value.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+  ::setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof(value));
+}
+
+void SocketStreamBuf::ShutdownWrite() { ::shutdown(fd_, SHUT_WR); }
+
+bool SocketStreamBuf::Send(const char *data, size_t size) {
+  while (size != 0) {
+    ssize_t sent = ::send(fd_, data, size, kSendFlags);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+#else
+UnixListener::UnixListener(const std::string &path) : path_(path) {
+  throw std::runtime_error("Unix domain sockets are not supported."s);
+}
+
+UnixListener::~UnixListener() = default;
+
+int UnixListener::Accept() { return -1; }
+
+void UnixListener::Wake() {}
+
+int ConnectUnixSocket(const std::string &) {
+  throw std::runtime_error("Unix domain sockets are not supported."s);
+}
+
+SocketStreamBuf::SocketStreamBuf(int fd) : fd_(fd) {}
+
+SocketStreamBuf::~SocketStreamBuf() = default;
+
+ReadStatus SocketStreamBuf::ReadLine(std::string &,
+                                    std::chrono::milliseconds) {
+  return ReadStatus::Closed;
+}
+
+void SocketStreamBuf::SetSendTimeout(std::chrono::milliseconds) {}
+
+void SocketStreamBuf::ShutdownWrite() {}
+
+bool SocketStreamBuf::Send(const char *, size_t) { return false; }
+#endif
+
+SocketStreamBuf::int_type SocketStreamBuf::overflow(int_type c) {
+  if (traits_type::eq_int_type(c, traits_type::eof())) {
+    return traits_type::not_eof(c);
+  }
+  char ch = traits_type::to_char_type(c);
+  return Send(&ch, 1) ? c : traits_type::eof();
+}
+
+std::streamsize SocketStreamBuf::xsputn(const char *data,
+                                        std::streamsize size) {
+  return Send(data, static_cast<size_t>(size)) ? size : 0;
+}
+
+} // namespace util
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <streambuf>
+#include <string>
+
+namespace util {
+
+// Listening Unix domain stream socket. A socket file left at the path by a
+// listener that is gone is replaced, anything else there throws. The file
+// is removed when the listener is destroyed.
+class UnixListener {
+public:
+  explicit UnixListener(const std::string &path);
+  ~UnixListener();
+
+  UnixListener(const UnixListener &) = delete;
+  UnixListener &operator=(const UnixListener &) = delete;
+
+  // Blocks until a client connects. Returns the connected socket, or -1
+  // when the wait was interrupted by a signal or Wake() was called.
+  int Accept();
+  // Makes the waiting Accept and all later ones return -1. Safe to call
+  // from a signal handler.
+  void Wake();
+
+private:
+  std::string path_;
+  int fd_ = -1;
+  // self-pipe, a byte in it means Wake() was called
+  int wake_[2] = {-1, -1};
+};
+
+// Connects to the listener at path, throws if nobody listens there.
+int ConnectUnixSocket(const std::string &path);
+
+enum class ReadStatus { Line, Closed, Timeout };
+
+// Owns a connected socket. Request lines are read from it and the response
+// is written through the stream buffer. Writes never raise SIGPIPE, a
+// closed peer makes the stream fail instead.
+class SocketStreamBuf : public std::streambuf {
+public:
+  explicit SocketStreamBuf(int fd);
+  ~SocketStreamBuf() override;
+
+  SocketStreamBuf(const SocketStreamBuf &) = delete;
+  SocketStreamBuf &operator=(const SocketStreamBuf &) = delete;
+
+  // Reads up to the next new line and returns the text before it. Returns
+  // Closed when the peer closed the socket first and Timeout when no line
+  // came in time, the received part is kept for the next call. Throws for
+  // lines longer than kMaxLine.
+  ReadStatus ReadLine(std::string &line, std::chrono::milliseconds timeout);
+  // Writes that block longer than timeout fail the stream.
+  void SetSendTimeout(std::chrono::milliseconds timeout);
+  // Ends the output, the peer reads the end of the stream.
+  void ShutdownWrite();
+
+  static constexpr size_t kMaxLine = 64 * 1024;
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *data, std::streamsize size) override;
+
+private:
+  bool Send(const char *data, size_t size);
+
+  int fd_ = -1;
+  std::string input_;
+};
+
+} // namespace util
@@ -1,314 +1,801 @@
 #include <algorithm>
 #include <array>
+#include <charconv>
+#include <chrono>
 #include <concepts>
+#include <csignal>
+#include <ctime>
+#include <filesystem>
+#include <future>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <optional>
 #include <ranges>
 #include <source_location>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include "charconv_util.h"
+#include "file_watcher.h"
 #include "format_utils.h"
+#include "hash_util.h"
 #include "mml_utils.h"
 #include "param_compare.h"
-#include "param_fabric.h"
 #include "params.h"
+#include "report.h"
+#include "snapshot.h"
 #include "soft_param.h"
+#include "stats.h"
+#include "table_report.h"
 #include "tabulator.h"
+#include "thread_pool.h"
+#include "type_registry.h"
+#include "unix_socket.h"
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 
 void print_vector(std::ostream &out, const std::vector<std::string> &data) {
   for (const auto &line : data) {
     out << line << '\n';
   }
 }
-mml::MapStringString GetMapTypeToValue() {
-  static mml::MapStringString result = {{{"BIT"s, "BITVALUE"s},
-                                         {"BYTE"s, "BYTEVALUE"s},
-                                         {"DWORD"s, "DWORDVALUE"s},
-                                         {"STRING"s, "STRINGVALUE"s},
-                                         {"BIT_EX"s, "BITVALUE"s},
-                                         {"BYTE_EX"s, "BYTEVALUE"s},
-                                         {"DWORD_EX"s, "DWORDVALUE"s},
-                                         {"STRING_EX"s, "STRINGVALUE"s},
-                                         {"BIT_EX_B"s, "BITVALUE"s},
-                                         {"BYTE_EX_B"s, "BYTEVALUE"s},
-                                         {"DWORD_EX_B"s, "DWORDVALUE"s},
-                                         {"STRING_EX_B"s, "STRINGVALUE"s}}};
-  return result;
+
+std::unique_ptr<sft::IReportSink>
+CreateSink(sft::BufferedWriter &out, const my::CompareSettings &settings) {
+  switch (settings.format_) {
+  case sft::ReportFormat::Ndjson:
+    return std::make_unique<sft::NdjsonSink>(out);
+  case sft::ReportFormat::Csv:
+    return std::make_unique<sft::CsvSink>(out);
+  case sft::ReportFormat::Grouped:
+    return std::make_unique<sft::GroupedTableSink>(out, settings.table_info_);
+  case sft::ReportFormat::Table:
+    break;
+  }
+  return std::make_unique<sft::TableSink>(out, settings.table_info_);
 }
 
-mml::MapStringString GetMapTypeToNumberName() {
-  static mml::MapStringString result = {{{"BIT"s, "BITNUM"s},
-                                         {"BYTE"s, "BYTENUM"s},
-                                         {"DWORD"s, "DWORDNUM"s},
-                                         {"STRING"s, "STRINGNUM"s},
-                                         {"BIT_EX"s, "BITNUM"s},
-                                         {"BYTE_EX"s, "BYTENUM"s},
-                                         {"DWORD_EX"s, "DWORDNUM"s},
-                                         {"STRING_EX"s, "STRINGNUM"s},
-                                         {"BIT_EX_B"s, "BITNUM"s},
-                                         {"BYTE_EX_B"s, "BYTENUM"s},
-                                         {"DWORD_EX_B"s, "DWORDNUM"s},
-                                         {"STRING_EX_B"s, "STRINGNUM"s}}};
-  return result;
+sft::VectorParameterPair &
+SortByPrintOrder(sft::VectorParameterPair &differences) {
+
+  static const std::source_location location = std::source_location::current();
+  auto get_print_order = [](const sft::ParameterPair &item) {
+    const sft::ParameterInfo &info = item.GetInfo();
+    if (const sft::TypeDescriptor *type = sft::FindType(info.type_)) {
+      return std::tie(type->print_rank_, info.type_, info.id_);
+    } else {
+      throw std::invalid_argument(
+          location.file_name() + ":"s + location.function_name() +
+          " Sort print_order not found for '"s + info.type_ + "'."s);
+    }
+  };
+
+  std::ranges::sort(differences, {}, get_print_order);
+
+  return differences;
 }
 
-std::map<std::string, size_t> GetPrintOrderMap() {
-  std::map<std::string, size_t> result = {{{"BIT"s, 1},
-                                           {"BYTE"s, 2},
-                                           {"DWORD"s, 3},
-                                           {"STRING"s, 4},
-                                           {"BIT_EX"s, 5},
-                                           {"BYTE_EX"s, 6},
-                                           {"DWORD_EX"s, 7},
-                                           {"STRING_EX"s, 8},
-                                           {"BIT_EX_B"s, 9},
-                                           {"BYTE_EX_B"s, 10},
-                                           {"DWORD_EX_B"s, 11},
-                                           {"STRING_EX_B"s, 12}}};
+my::SortedParams LoadParamAndIndex(const mml::LoadedFile &file,
+                                   const mml::ConvertInfo &ci,
+                                   const std::string &prefix,
+                                   util::Stats *stats) {
+  my::SortedParams result;
+  {
+    std::optional<mml::VectorRecordView> records;
+    {
+      util::StageTimer timer(stats, "tokenize"sv);
+      records.emplace(file.GetRecords(prefix));
+    }
+    util::StageTimer timer(stats, "convert"sv);
+    result.data_ = sft::Convert(*records, ci);
+  }
+  {
+    util::StageTimer timer(stats, "sort"sv);
+    result.fingerprint_ = sft::SortTable(result.data_);
+  }
+  if (stats) {
+    stats->Add("records_converted"sv, result.data_.size());
+  }
   return result;
 }
 
-mml::ConvertInfo GetConvertInfo(const std::string &type_key) {
-  mml::ConvertInfo result;
-  result.type_to_number_ = GetMapTypeToNumberName();
-  result.type_to_value_ = GetMapTypeToValue();
-  result.type_key_ = type_key;
-  return result;
+// Lines of the file and lines found for each command.
+void AddLineCounters(util::Stats &stats, const mml::LoadedFile &file) {
+  std::string_view data = file.GetData();
+  size_t lines = std::ranges::count(data, '\n');
+  if (!data.empty() && data.back() != '\n') {
+    ++lines;
+  }
+  stats.Add("lines_scanned"sv, lines);
+  for (const auto &[command, offsets] : file.GetIndex().data_) {
+    stats.Add("lines_matched[" + command + "]", offsets.data_.size());
+  }
 }
 
-sft::FabricMap GetFabricMap() {
-  static sft::FabricMap result = {
-      {"BIT"s, sft::CreateBitSoftParameter},
-      {"BYTE"s, sft::CreateByteSoftParameter},
-      {"DWORD"s, sft::CreateDwordSoftParameter},
-      {"STRING"s, sft::CreateStringSoftParameter},
-      {"BIT_EX"s, sft::CreateBitSoftParameter},
-      {"BYTE_EX"s, sft::CreateByteSoftParameter},
-      {"DWORD_EX"s, sft::CreateDwordSoftParameter},
-      {"STRING_EX"s, sft::CreateStringSoftParameter},
-      {"BIT_EX_B"s, sft::CreateBitSoftParameter},
-      {"BYTE_EX_B"s, sft::CreateByteSoftParameter},
-      {"DWORD_EX_B"s, sft::CreateDwordSoftParameter},
-      {"STRING_EX_B"s, sft::CreateStringSoftParameter}};
-  return result;
+// Everything that changes the parsed table, snapshots of other settings are
+// not used.
+uint64_t GetSettingsKey(const my::CompareSettings &settings) {
+  uint64_t key = util::Hash64(settings.prefix_);
+  for (const auto &item : {settings.sys_prefix_, settings.ne_name_field_,
+                           settings.ci_.type_key_}) {
+    key = util::HashCombine(key, util::Hash64(item));
+  }
+  for (const auto *dict :
+       {&settings.ci_.type_to_number_, &settings.ci_.type_to_value_}) {
+    for (const auto &[type, field] : dict->data_) {
+      key = util::HashCombine(key, util::Hash64(type));
+      key = util::HashCombine(key, util::Hash64(field));
+    }
+  }
+  return key;
+}
+
+my::CompareSettings GetCompareSettings(const my::Options &options) {
+  my::CompareSettings settings;
+  settings.prefix_ = "SET SOFTPARA:"s;
+  settings.sys_prefix_ = "SET SYS:"s;
+  settings.ne_name_field_ = "NM"s;
+  settings.ci_ = sft::GetConvertInfo("DT"s);
+  settings.table_info_ = sft::PrepareTableInfo();
+  settings.cache_dir_ = options.cache_dir_;
+  settings.format_ = options.format_;
+  settings.settings_key_ = GetSettingsKey(settings);
+  return settings;
 }
 
-sft::FabricDifferenceMap GetFabricDifferenceMap() {
-  static sft::FabricDifferenceMap result = {
-      {"BIT"s, sft::CreateBitDifference},
-      {"BYTE"s, sft::CreateByteDifference},
-      {"DWORD"s, sft::CreateDwordDifference},
-      {"STRING"s, sft::CreateStringDifference},
-      {"BIT_EX"s, sft::CreateBitDifference},
-      {"BYTE_EX"s, sft::CreateByteDifference},
-      {"DWORD_EX"s, sft::CreateDwordDifference},
-      {"STRING_EX"s, sft::CreateStringDifference},
-      {"BIT_EX_B"s, sft::CreateBitDifference},
-      {"BYTE_EX_B"s, sft::CreateByteDifference},
-      {"DWORD_EX_B"s, sft::CreateDwordDifference},
-      {"STRING_EX_B"s, sft::CreateStringDifference}};
+my::SortedParams ParseSortedParams(mml::MappedFile mapped,
+                                   const my::CompareSettings &settings) {
+  std::vector<std::string> commands = {settings.prefix_, settings.sys_prefix_};
+  std::optional<mml::LoadedFile> file;
+  {
+    util::StageTimer timer(settings.stats_, "index"sv);
+    file.emplace(std::move(mapped), commands);
+  }
+  if (settings.stats_) {
+    AddLineCounters(*settings.stats_, *file);
+  }
+
+  my::SortedParams result =
+      LoadParamAndIndex(*file, settings.ci_, settings.prefix_, settings.stats_);
+  result.ne_ =
+      mml::GetNeName(*file, settings.sys_prefix_, settings.ne_name_field_);
   return result;
 }
 
-my::TableInfo PrepareTableInfo() {
-  my::TableInfo info;
-  info.desc_ = {{13, "Name"s, tab::Adjust::Left},
-                {11, "Number"s, tab::Adjust::Right},
-                {12, "Value"s, tab::Adjust::Right},
-                {40, "Value(bin)"s, tab::Adjust::Right}};
-  info.top_line_ = tab::GetTopLine(info.desc_);
-  info.header_line_ = tab::GetHeaderLine(info.desc_);
-  info.sep_line_ = tab::GetRowSeparatorLine(info.desc_);
-  info.footer_line_ = tab::GetFooterLine(info.desc_);
-  return info;
+// Takes the table from the snapshot cache when it is enabled and the
+// snapshot matches the file, otherwise parses the file and stores a new one.
+my::SortedParams LoadSortedParams(const std::string &filename,
+                                  const my::CompareSettings &settings) {
+  mml::MappedFile mapped;
+  {
+    util::StageTimer timer(settings.stats_, "read"sv);
+    mapped = mml::MappedFile(filename);
+  }
+  if (settings.stats_) {
+    settings.stats_->Add("bytes_read"sv, mapped.GetSize());
+  }
+  if (settings.cache_dir_.empty()) {
+    return ParseSortedParams(std::move(mapped), settings);
+  }
+
+  std::optional<util::StageTimer> timer;
+  timer.emplace(settings.stats_, "snapshot"sv);
+  sft::SourceStamp stamp = sft::GetSourceStamp(filename, mapped.GetData());
+  std::string path = sft::GetSnapshotPath(settings.cache_dir_, filename);
+  if (auto snapshot = sft::ReadSnapshot(path, stamp, settings.settings_key_)) {
+    my::SortedParams result{std::move(snapshot->data_),
+                            std::move(snapshot->ne_), {}};
+    result.fingerprint_ = sft::GetFingerprint(result.data_);
+    return result;
+  }
+  timer.reset();
+
+  my::SortedParams result = ParseSortedParams(std::move(mapped), settings);
+  timer.emplace(settings.stats_, "snapshot"sv);
+  try {
+    std::filesystem::create_directories(settings.cache_dir_);
+    sft::WriteSnapshot(path, stamp, settings.settings_key_, result.data_,
+                       result.ne_);
+  } catch (std::exception &e) {
+    std::cerr << "Snapshot is not saved: " << e.what() << "\n";
+  }
+  return result;
 }
 
-std::unique_ptr<sft::SoftParameter>
-CreateParameter(std::optional<sft::ParameterInfo> info,
-                const sft::FabricMap &parameter_fabric) {
-  if (info) {
-    return sft::FabricParameter(parameter_fabric, *info);
+// Parses the file in windows and feeds the parameters to an external
+// sorter, so memory use is bounded by the budget instead of the file size.
+my::StreamedParams LoadStreamedParams(const std::string &filename,
+                                      const my::CompareSettings &settings,
+                                      size_t memory_budget) {
+  const size_t kMinWindow = 1ul << 20;
+  const size_t kMaxWindow = 64ul << 20;
+
+  my::StreamedParams result;
+  result.sorter_ = std::make_unique<sft::ExternalSorter>(
+      memory_budget, sft::ExternalSorter::kMergeWidth, sft::ComparePrintOrder);
+
+  mml::MappedFile file(filename);
+  if (settings.stats_) {
+    settings.stats_->Add("bytes_read"sv, file.GetSize());
   }
-  return nullptr;
+  mml::RecordView record;
+  size_t records = 0;
+  std::vector<std::string> commands = {settings.prefix_, settings.sys_prefix_};
+  mml::scan_commands(
+      file.GetData(), commands,
+      std::clamp(memory_budget / 4, kMinWindow, kMaxWindow),
+      [&](size_t command, std::string_view line) {
+        line.remove_prefix(commands[command].size());
+        mml::get_record_from_line(line, ',', record);
+        if (command == 0) {
+          result.sorter_->Add(sft::GetParameterInfo(record, settings.ci_));
+          ++records;
+        } else if (result.ne_.empty()) {
+          result.ne_ = mml::GetItemByKey(record, settings.ne_name_field_);
+        }
+      });
+  result.sorter_->Finish();
+  if (settings.stats_) {
+    settings.stats_->Add("records_converted"sv, records);
+  }
+  return result;
 }
 
-std::unique_ptr<sft::IDifference>
-CreateDifference(const std::optional<sft::ParameterInfo> info1,
-                 const std::optional<sft::ParameterInfo> info2,
-                 const sft::FabricDifferenceMap &difference_fabric) {
-  sft::DifferenceInfo di;
-  if (!(info1 || info2)) {
-    return nullptr;
-  }
-  if (info1) {
-    di.type_ = info1->type_;
-    di.id_ = info1->id_;
-    di.value1_ = info1->value_;
-  }
-  if (info2) {
-    di.type_ = info2->type_;
-    di.id_ = info2->id_;
-    di.value2_ = info2->value_;
-  }
-  return sft::FabricDifference(difference_fabric, di);
+// Current local time as HH:MM:SS.
+std::string GetTimeOfDay() {
+  std::time_t now =
+      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  char buffer[16];
+  size_t size =
+      std::strftime(buffer, sizeof(buffer), "%H:%M:%S", std::localtime(&now));
+  return std::string(buffer, size);
 }
 
-void PrintResults(std::ostream &out, const my::ComparsionResults &cr,
-                  const my::TableInfo &ti, const sft::KeyTypeId &type_id) {
-  out << "Difference: NE1 : " << cr.ne[0] << " NE2 : " << cr.ne[1] << '\n';
-
-  out << ti.top_line_ << '\n';
-  out << ti.header_line_ << '\n';
-  out << ti.sep_line_ << '\n';
-
-  tab::VectorString row;
-
-  row.reserve(ti.desc_.size());
-  std::ranges::for_each(cr.param_,
-                        [&out, &ti, &type_id, &row](const auto &ptr) {
-                          if (ptr) {
-                            row.emplace_back(type_id.type_);
-                            row.emplace_back(std::to_string(type_id.id_));
-                            row.emplace_back(ptr->GetShortValue());
-                            row.emplace_back(ptr->GetLongValue());
-                          } else {
-                            row.resize(ti.desc_.size());
-                          }
-                          auto row_line = tab::GetRowLine(ti.desc_, row);
-                          row.resize(0);
-                          out << row_line << '\n';
-                        });
-
-  out << ti.footer_line_ << '\n';
-
-  if (cr.diff_) {
-    std::ranges::for_each(cr.diff_->GetDetails(),
-                          [&out](const auto &item) { out << item << '\n'; });
-    out << '\n';
+// Prints the report, watch_report is its number in --watch mode and 0
+// otherwise.
+void PrintDifferences(std::ostream &out,
+                      sft::VectorParameterPair &differences,
+                      const std::array<std::string, 2> &ne,
+                      const my::CompareSettings &settings,
+                      size_t watch_report = 0) {
+  // the report is built in one buffer and written in large blocks
+  util::StageTimer timer(settings.stats_, "render"sv);
+  SortByPrintOrder(differences);
+  const sft::VectorDifferenceRecord records =
+      sft::MakeDifferences(differences, sft::FindValueKind);
+
+  sft::BufferedWriter writer(out);
+  auto sink = CreateSink(writer, settings);
+  if (watch_report) {
+    sft::WriteWatchReport(writer, *sink, watch_report, GetTimeOfDay(), ne[0],
+                          ne[1], records);
+  } else {
+    sink->BeginPair(ne[0], ne[1]);
+    for (const auto &record : records) {
+      sink->Add(record);
+    }
+    sink->EndPair();
+  }
+  writer.Flush();
+  if (settings.stats_) {
+    settings.stats_->Add("differences"sv, records.size());
+    settings.stats_->Add("output_bytes"sv, writer.GetWrittenBytes());
   }
 }
 
-sft::KeysVector &
-SortByPrintOrder(sft::KeysVector &common_index,
-                 const std::map<std::string, size_t> &print_order) {
+// Compares two sorted tables and prints the report.
+void CompareTables(std::ostream &out, const sft::VectorParameterInfo &v1,
+                   const sft::TableFingerprint &f1,
+                   const sft::VectorParameterInfo &v2,
+                   const sft::TableFingerprint &f2,
+                   const std::array<std::string, 2> &ne,
+                   const my::CompareSettings &settings) {
+  sft::VectorParameterPair differences;
+  {
+    util::StageTimer timer(settings.stats_, "diff"sv);
+    differences = sft::GetDifferentParameters(v1, f1, v2, f2);
+  }
+  if (settings.stats_) {
+    settings.stats_->Add("common_keys"sv, sft::CountCommonKeys(v1, v2));
+  }
+  PrintDifferences(out, differences, ne, settings);
+}
 
-  static const std::source_location location = std::source_location::current();
-  auto get_print_order = [&print_order](const sft::KeyTypeId &item) {
-    if (auto search = print_order.find(item.type_);
-        search != print_order.end()) {
-      return std::tie(search->second, item.type_, item.id_);
-    } else {
-      throw std::invalid_argument(
-          location.file_name() + ":"s + location.function_name() +
-          " Sort print_order not found for '"s + item.type_ + "'."s);
-    }
-  };
+void CompareSortedParams(std::ostream &out, const my::SortedParams &params1,
+                         const my::SortedParams &params2,
+                         const my::CompareSettings &settings) {
+  CompareTables(out, params1.data_, params1.fingerprint_, params2.data_,
+                params2.fingerprint_, {params1.ne_, params2.ne_}, settings);
+}
 
-  std::ranges::sort(common_index, {}, get_print_order);
+void compare_soft_params(const std::string &input1, const std::string &input2,
+                         const my::CompareSettings &settings) {
+  std::array<my::SortedParams, 2> params = {
+      LoadSortedParams(input1, settings), LoadSortedParams(input2, settings)};
 
-  return common_index;
+  CompareSortedParams(std::cout, params[0], params[1], settings);
 }
 
-my::SortedParams LoadParamAndIndex(const std::string &filename,
-                                   const mml::ConvertInfo &ci,
-                                   std::string &prefix) {
-  my::SortedParams result;
-  result.data_ = sft::Load(filename, prefix, ci);
-  auto two_fields = [](const sft::ParameterInfo &pi) {
-    return sft::KeyTypeId{pi.type_, pi.id_};
-  };
-  std::ranges::sort(result.data_, {}, two_fields);
-  return result;
+volatile std::sig_atomic_t interrupted = 0;
+// listener of --serve, woken by the signals while it exists
+util::UnixListener *volatile serving_listener = nullptr;
+
+void Interrupt(int) {
+  interrupted = 1;
+  if (util::UnixListener *listener = serving_listener) {
+    listener->Wake();
+  }
 }
 
-void compare_soft_params(const std::string &input1, const std::string &input2) {
+// Reads the new version of a watched file into its table. Only the lines
+// that are not in the previous version are tokenized.
+void UpdateWatchedParams(const std::string &filename, my::WatchedParams &params,
+                         const my::CompareSettings &settings) {
+  std::vector<std::string> commands = {settings.prefix_, settings.sys_prefix_};
+  std::optional<mml::LoadedFile> file;
+  {
+    util::StageTimer timer(settings.stats_, "index"sv);
+    file.emplace(filename, commands);
+  }
+  {
+    util::StageTimer timer(settings.stats_, "convert"sv);
+    params.table_.Update(*file);
+  }
+  params.ne_ =
+      mml::GetNeName(*file, settings.sys_prefix_, settings.ne_name_field_);
+  if (settings.stats_) {
+    settings.stats_->Add("lines_reparsed"sv,
+                         params.table_.GetParsedLineCount());
+    settings.stats_->Add("changed_keys"sv,
+                         params.table_.GetChangedKeys().size());
+  }
+}
 
-  std::string prefix = "SET SOFTPARA:"s;
-  std::string type_field = "DT"s;
-  mml::ConvertInfo ci = GetConvertInfo(type_field);
+// Prints the report of the two files, then again each time one of them has
+// been written and settled, until SIGINT or SIGTERM. Only the changed lines
+// of the changed file are parsed again and only the keys they changed and
+// the keys of the last report are compared again. A file that fails to
+// parse keeps its previous table.
+void watch_soft_params(const std::string &input1, const std::string &input2,
+                       const my::CompareSettings &settings) {
+  const std::chrono::milliseconds kSettle(50);
+  const std::array<std::string, 2> files = {input1, input2};
+
+  util::FileWatcher watcher({input1, input2});
+  std::signal(SIGINT, Interrupt);
+  std::signal(SIGTERM, Interrupt);
+
+  std::array<my::WatchedParams, 2> params = {
+      my::WatchedParams{{settings.prefix_, settings.ci_}, {}},
+      my::WatchedParams{{settings.prefix_, settings.ci_}, {}}};
+  // keys of the differences in the last report, sorted
+  sft::KeysVector different;
+  size_t report = 0;
+  auto print = [&](sft::VectorParameterPair &differences) {
+    different.clear();
+    different.reserve(differences.size());
+    for (const auto &pair : differences) {
+      const auto &info = pair.GetInfo();
+      different.push_back({info.type_, info.id_});
+    }
+    std::ranges::sort(different);
+    if (settings.stats_) {
+      settings.stats_->Add(
+          "common_keys"sv, sft::CountCommonKeys(params[0].table_.GetData(),
+                                                params[1].table_.GetData()));
+    }
+    PrintDifferences(std::cout, differences, {params[0].ne_, params[1].ne_},
+                     settings, ++report);
+    std::cout.flush();
+  };
+  UpdateWatchedParams(input1, params[0], settings);
+  UpdateWatchedParams(input2, params[1], settings);
+  {
+    sft::VectorParameterPair differences;
+    {
+      util::StageTimer timer(settings.stats_, "diff"sv);
+      differences = sft::GetDifferentParameters(
+          params[0].table_.GetData(), params[0].table_.GetFingerprint(),
+          params[1].table_.GetData(), params[1].table_.GetFingerprint());
+    }
+    print(differences);
+  }
 
-  std::array<my::SortedParams, 2> params = {
-      LoadParamAndIndex(input1, ci, prefix),
-      LoadParamAndIndex(input2, ci, prefix)};
+  while (!interrupted) {
+    std::vector<size_t> changed = watcher.Wait(kSettle);
+    if (changed.empty()) {
+      continue;
+    }
+    // a key can change its difference only if it changed in a table
+    sft::KeysVector keys = different;
+    for (size_t i : changed) {
+      try {
+        UpdateWatchedParams(files[i], params[i], settings);
+      } catch (std::exception &e) {
+        std::cerr << files[i] << ": " << e.what() << "\n";
+        continue;
+      }
+      sft::KeysVector merged;
+      std::ranges::set_union(keys, params[i].table_.GetChangedKeys(),
+                             std::back_inserter(merged));
+      keys = std::move(merged);
+    }
+    sft::VectorParameterPair differences;
+    {
+      util::StageTimer timer(settings.stats_, "diff"sv);
+      differences = sft::GetDifferentParameters(
+          params[0].table_.GetData(), params[1].table_.GetData(), keys);
+    }
+    print(differences);
+  }
+}
 
-  sft::KeysVector common_index =
-      sft::CreateCommonIndex(params[0].data_, params[1].data_);
+// Same report as compare_soft_params for dumps larger than the memory.
+// The tables are sorted in print order, so every difference is rendered as
+// soon as the merge finds it and none of them is kept.
+void compare_streamed(const std::string &input1, const std::string &input2,
+                      size_t memory_budget,
+                      const my::CompareSettings &settings) {
+  // both tables are sorted and merged at the same time
+  std::optional<util::StageTimer> timer;
+  timer.emplace(settings.stats_, "stream_sort"sv);
+  std::array<my::StreamedParams, 2> params = {
+      LoadStreamedParams(input1, settings, memory_budget / 2),
+      LoadStreamedParams(input2, settings, memory_budget / 2)};
+
+  timer.emplace(settings.stats_, "diff"sv);
+  sft::BufferedWriter writer(std::cout);
+  auto sink = CreateSink(writer, settings);
+  size_t differences = 0;
+  sink->BeginPair(params[0].ne_, params[1].ne_);
+  sft::MergeJoin(
+      *params[0].sorter_, *params[1].sorter_,
+      [&](const sft::ParameterPair &pair) {
+        const std::string &type = pair.GetInfo().type_;
+        const sft::TypeDescriptor *descriptor = sft::FindType(type);
+        if (!descriptor) {
+          throw std::invalid_argument("Sort print_order not found for '"s +
+                                      type + "'."s);
+        }
+        sink->Add(sft::MakeDifference(descriptor->kind_, pair));
+        ++differences;
+      });
+  sink->EndPair();
+  writer.Flush();
+  timer.reset();
+  if (settings.stats_) {
+    settings.stats_->Add("differences"sv, differences);
+    settings.stats_->Add("output_bytes"sv, writer.GetWrittenBytes());
+  }
+}
 
-  my::TableInfo table_info = PrepareTableInfo();
+// Reads a byte count with an optional K, M or G suffix.
+size_t ParseSize(std::string_view arg) {
+  std::string_view value = arg.substr(arg.find('=') + 1);
+  size_t shift = 0;
+  if (!value.empty()) {
+    switch (value.back()) {
+    case 'K':
+      shift = 10;
+      break;
+    case 'M':
+      shift = 20;
+      break;
+    case 'G':
+      shift = 30;
+      break;
+    }
+  }
+  if (shift) {
+    value.remove_suffix(1);
+  }
+  auto size = util::to_int<size_t>(value);
+  if (!size || *size == 0) {
+    throw std::invalid_argument("Wrong size '"s + std::string(arg) + "'."s);
+  }
+  return *size << shift;
+}
 
-  sft::FabricDifferenceMap fabric_difference = GetFabricDifferenceMap();
-  sft::FabricMap fabric_parameter = GetFabricMap();
+// Compares every file against one baseline that is parsed only once. Files
+// are compared in parallel, reports are written in the order of the files.
+void compare_fleet(const std::string &baseline,
+                   const std::vector<std::string> &files, size_t threads,
+                   const my::CompareSettings &settings) {
+  const my::SortedParams base = LoadSortedParams(baseline, settings);
+
+  // the stages of the workers overlap, their times are kept apart from the
+  // wall time of the whole comparison
+  util::Stats worker_stats;
+  my::CompareSettings worker_settings = settings;
+  if (settings.stats_) {
+    worker_settings.stats_ = &worker_stats;
+  }
+  std::optional<util::StageTimer> timer;
+  timer.emplace(settings.stats_, "compare_files"sv);
+
+  util::ThreadPool pool(threads ? threads : util::GetDefaultThreadCount());
+  std::vector<std::future<std::string>> reports;
+  reports.reserve(files.size());
+  for (const auto &file : files) {
+    reports.emplace_back(pool.Async([&worker_settings, &base, &file]() {
+      std::ostringstream out;
+      CompareSortedParams(out, base, LoadSortedParams(file, worker_settings),
+                          worker_settings);
+      return out.str();
+    }));
+  }
 
-  std::string ne_name_field{"NM"s};
-  std::string sys_prefix{"SET SYS:"s};
+  for (size_t i = 0, is = files.size(); i != is; ++i) {
+    try {
+      std::cout << reports[i].get();
+    } catch (std::exception &e) {
+      std::cerr << files[i] << ": " << e.what() << "\n";
+    }
+  }
+  timer.reset();
+  if (settings.stats_) {
+    settings.stats_->Merge(worker_stats, "_cpu"sv);
+  }
+}
 
-  my::ComparsionResults results;
-  results.ne = {mml::LoadNeName(input1, sys_prefix, ne_name_field),
-                mml::LoadNeName(input2, sys_prefix, ne_name_field)};
+sft::ReportFormat ParseFormat(std::string_view arg) {
+  std::string_view value = arg.substr(arg.find('=') + 1);
+  if (value == "table"sv) {
+    return sft::ReportFormat::Table;
+  } else if (value == "grouped"sv) {
+    return sft::ReportFormat::Grouped;
+  } else if (value == "ndjson"sv) {
+    return sft::ReportFormat::Ndjson;
+  } else if (value == "csv"sv) {
+    return sft::ReportFormat::Csv;
+  }
+  throw std::invalid_argument("Wrong format '"s + std::string(arg) + "'."s);
+}
 
-  SortByPrintOrder(common_index, GetPrintOrderMap());
+// First line of a report: the title of the text formats or the header of
+// the machine readable ones.
+void PrintHeader(std::ostream &out, const my::CompareSettings &settings) {
+  const int ver_major = 1;
+  const int ver_minor = 0;
+  if (settings.format_ == sft::ReportFormat::Table ||
+      settings.format_ == sft::ReportFormat::Grouped) {
+    out << "Soft paremeters comparsion v" << ver_major << "." << ver_minor
+        << "\n";
+  } else {
+    sft::BufferedWriter writer(out);
+    CreateSink(writer, settings)->Begin();
+  }
+}
 
-  auto two_fields = [](const sft::ParameterInfo &pi) {
-    return sft::KeyTypeId{pi.type_, pi.id_};
-  };
+// Takes "[NAME=]FILE", the name defaults to the file.
+std::pair<std::string, std::string> SplitBaselineSpec(std::string_view spec) {
+  size_t pos = spec.find('=');
+  if (pos == std::string_view::npos) {
+    return {std::string(spec), std::string(spec)};
+  }
+  return {std::string(spec.substr(0, pos)), std::string(spec.substr(pos + 1))};
+}
 
-  std::ranges::for_each(common_index, [&params, &table_info, &fabric_parameter,
-                                       &fabric_difference, two_fields,
-                                       &results](const auto &key_value) {
-    std::array<std::optional<sft::ParameterInfo>, 2> param_info;
-
-    std::ranges::transform(
-        params, param_info.begin(),
-        [&key_value, two_fields](
-            const auto &parameter) -> std::optional<sft::ParameterInfo> {
-          if (auto search = sft::binary_find(parameter.data_.begin(),
-                                             parameter.data_.end(), key_value,
-                                             {}, two_fields);
-              search != parameter.data_.end()) {
-            return *search;
-          }
-          return {};
-        });
-
-    if (param_info[0] == param_info[1]) {
+// Answers one "BASELINE FORMAT FILE" request line with "OK" and the report
+// of FILE against the baseline, or with "ERROR" and the reason. A client
+// that sends no line within the timeout, or until the server stops, gets an
+// error, so idle clients don't hold the workers.
+void ServeClient(int fd,
+                 const std::map<std::string, my::SortedParams> &baselines,
+                 const my::CompareSettings &settings) {
+  const std::chrono::seconds kTimeout(10);
+  const std::chrono::milliseconds kSlice(100);
+
+  util::SocketStreamBuf buffer(fd);
+  buffer.SetSendTimeout(kTimeout);
+  std::ostream out(&buffer);
+  std::string line;
+  bool answered = false;
+  try {
+    const auto deadline = std::chrono::steady_clock::now() + kTimeout;
+    util::ReadStatus status;
+    while ((status = buffer.ReadLine(line, kSlice)) ==
+           util::ReadStatus::Timeout) {
+      if (interrupted) {
+        throw std::runtime_error("Server is shutting down."s);
+      }
+      if (std::chrono::steady_clock::now() >= deadline) {
+        throw std::runtime_error("No request line in time."s);
+      }
+    }
+    if (status == util::ReadStatus::Closed) {
       return;
     }
+    size_t first = line.find(' ');
+    size_t second = line.find(' ', first == line.npos ? first : first + 1);
+    if (second == line.npos || second + 1 == line.size()) {
+      throw std::invalid_argument("Request must be 'BASELINE FORMAT FILE'."s);
+    }
+    auto base = baselines.find(line.substr(0, first));
+    if (base == baselines.end()) {
+      throw std::invalid_argument("Unknown baseline '"s +
+                                  line.substr(0, first) + "'."s);
+    }
+    my::CompareSettings request = settings;
+    request.format_ = ParseFormat(
+        std::string_view(line).substr(first + 1, second - first - 1));
+    my::SortedParams params = LoadSortedParams(line.substr(second + 1),
+                                               request);
+
+    out << "OK\n";
+    answered = true;
+    PrintHeader(out, request);
+    CompareSortedParams(out, base->second, params, request);
+    out.flush();
+  } catch (std::exception &e) {
+    if (!answered) {
+      out << "ERROR " << e.what() << "\n";
+    }
+    std::cerr << line << ": " << e.what() << "\n";
+  }
+  buffer.ShutdownWrite();
+}
 
-    std::ranges::transform(param_info, results.param_.begin(),
-                           [&fabric_parameter](const auto &info) {
-                             return CreateParameter(info, fabric_parameter);
-                           });
+// Preloads the baselines, then answers the requests of the clients of the
+// socket in parallel until SIGINT or SIGTERM.
+void serve_baselines(const std::string &socket_path,
+                     const std::vector<std::string> &specs, size_t threads,
+                     const my::CompareSettings &settings) {
+  std::map<std::string, my::SortedParams> baselines;
+  for (const auto &spec : specs) {
+    auto [name, file] = SplitBaselineSpec(spec);
+    if (baselines.contains(name)) {
+      throw std::invalid_argument("Baseline '"s + name + "' is repeated."s);
+    }
+    baselines.emplace(std::move(name), LoadSortedParams(file, settings));
+  }
 
-    results.diff_ =
-        CreateDifference(param_info[0], param_info[1], fabric_difference);
-    if (results.diff_) {
-      PrintResults(std::cout, results, table_info, key_value);
+  util::UnixListener listener(socket_path);
+  struct ServingListener {
+    explicit ServingListener(util::UnixListener &listener) {
+      serving_listener = &listener;
+    }
+    ~ServingListener() { serving_listener = nullptr; }
+  } serving(listener);
+  std::signal(SIGINT, Interrupt);
+  std::signal(SIGTERM, Interrupt);
+  // queued requests are answered before the socket is removed, the workers
+  // block the signals so they wake the listener of this thread
+  util::ThreadPool pool(threads ? threads : util::GetDefaultThreadCount());
+  while (!interrupted) {
+    int fd = listener.Accept();
+    if (fd < 0) {
+      continue;
     }
-  });
+    pool.Submit([fd, &baselines, &settings]() {
+      ServeClient(fd, baselines, settings);
+    });
+  }
 }
 
-int main(int argc, char *argv[]) {
-  int ver_major = 1;
-  int ver_minor = 0;
-  std::cout << "Soft paremeters comparsion v" << ver_major << "." << ver_minor
-            << "\n";
+my::Options ParseOptions(int argc, char *argv[]) {
+  my::Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg.starts_with("--baseline="sv)) {
+      options.baseline_ = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--threads="sv)) {
+      auto threads = util::to_int<size_t>(arg.substr(arg.find('=') + 1));
+      if (!threads) {
+        throw std::invalid_argument("Wrong thread count '"s +
+                                    std::string(arg) + "'."s);
+      }
+      options.threads_ = *threads;
+    } else if (arg.starts_with("--cache-dir="sv)) {
+      options.cache_dir_ = arg.substr(arg.find('=') + 1);
+    } else if (arg.starts_with("--memory-budget="sv)) {
+      // smaller budgets only add run files, the scan window is 1M anyway
+      const size_t kMinMemoryBudget = 4ul << 20;
+      options.memory_budget_ = ParseSize(arg);
+      if (options.memory_budget_ < kMinMemoryBudget) {
+        throw std::invalid_argument("--memory-budget must be at least 4M."s);
+      }
+    } else if (arg.starts_with("--format="sv)) {
+      options.format_ = ParseFormat(arg);
+    } else if (arg.starts_with("--serve="sv)) {
+      options.serve_ = arg.substr(arg.find('=') + 1);
+    } else if (arg == "--watch"sv) {
+      options.watch_ = true;
+    } else if (arg == "--stats"sv) {
+      options.stats_ = my::StatsMode::Text;
+    } else if (arg == "--stats=json"sv) {
+      options.stats_ = my::StatsMode::Json;
+    } else if (arg.starts_with("--"sv)) {
+      throw std::invalid_argument("Unknown option '"s + std::string(arg) +
+                                  "'."s);
+    } else {
+      options.files_.emplace_back(arg);
+    }
+  }
 
-  std::string filename = "example.txt";
-  std::string filename2 = "example01.txt";
-  if (3 == argc) {
-    filename = argv[1];
-    filename2 = argv[2];
+  if (!options.serve_.empty()) {
+    if (options.files_.empty() || !options.baseline_.empty() ||
+        options.memory_budget_ || options.watch_) {
+      throw std::invalid_argument(
+          "--serve needs baselines and can't be used with --baseline, "
+          "--memory-budget or --watch."s);
+    }
+  } else if (options.baseline_.empty()) {
+    if (options.files_.empty()) {
+      options.files_ = {"example.txt"s, "example01.txt"s};
+    } else if (options.files_.size() != 2) {
+      throw std::invalid_argument(
+          "Usage: soft_para_diff [OPTIONS] [--cache-dir=DIR] FILE1 FILE2\n"
+          "       soft_para_diff [OPTIONS] --watch FILE1 FILE2\n"
+          "       soft_para_diff [OPTIONS] --memory-budget=SIZE FILE1 FILE2\n"
+          "       soft_para_diff [OPTIONS] --baseline=FILE [--threads=N] "
+          "[--cache-dir=DIR] FILE...\n"
+          "       soft_para_diff [OPTIONS] --serve=SOCKET [--threads=N] "
+          "[--cache-dir=DIR] [NAME=]BASELINE...\n"
+          "Options: --format=table|grouped|ndjson|csv --stats[=json]"s);
+    }
+  } else if (options.memory_budget_) {
+    throw std::invalid_argument(
+        "--memory-budget can't be used with --baseline."s);
+  }
+  if (options.watch_ && (!options.baseline_.empty() ||
+                         options.memory_budget_ ||
+                         !options.cache_dir_.empty())) {
+    throw std::invalid_argument("--watch can't be used with --baseline, "
+                                "--memory-budget or --cache-dir."s);
   }
+  return options;
+}
+
+int main(int argc, char *argv[]) {
+  util::Stats stats;
+  my::StatsMode stats_mode = my::StatsMode::Off;
 
   try {
-    compare_soft_params(filename, filename2);
+    my::Options options = ParseOptions(argc, argv);
+    stats_mode = options.stats_;
+    my::CompareSettings settings = GetCompareSettings(options);
+    if (stats_mode != my::StatsMode::Off) {
+      settings.stats_ = &stats;
+    }
+    if (options.serve_.empty()) {
+      PrintHeader(std::cout, settings);
+    }
+
+    if (!options.serve_.empty()) {
+      // every response has its own header
+      serve_baselines(options.serve_, options.files_, options.threads_,
+                      settings);
+    } else if (!options.baseline_.empty()) {
+      compare_fleet(options.baseline_, options.files_, options.threads_,
+                    settings);
+    } else if (options.memory_budget_) {
+      compare_streamed(options.files_[0], options.files_[1],
+                       options.memory_budget_, settings);
+    } else if (options.watch_) {
+      watch_soft_params(options.files_[0], options.files_[1], settings);
+    } else {
+      compare_soft_params(options.files_[0], options.files_[1], settings);
+    }
   } catch (std::exception &e) {
     std::cerr << e.what() << "\n";
   }
+
+  if (stats_mode != my::StatsMode::Off) {
+    std::cout.flush();
+    stats.Add("peak_rss_bytes"sv, util::GetPeakRss());
+    if (stats_mode == my::StatsMode::Json) {
+      stats.PrintJson(std::cerr);
+    } else {
+      stats.Print(std::cerr);
+    }
+  }
 }
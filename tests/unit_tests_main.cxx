@@ -1,16 +1,81 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <sstream>
 #include <gtest/gtest.h>
 
 #include "charconv_util.h"
+#include "external_sort.h"
+#include "file_watcher.h"
 #include "format_utils.h"
+#include "incremental_table.h"
+#include "line_scanner.h"
+#include "mml_tokenizer.h"
+#include "mml_utils.h"
 #include "param_compare.h"
+#include "param_fabric.h"
 #include "params.h"
+#include "report.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "table_report.h"
 #include "tabulator.h"
+#include "thread_pool.h"
+#include "type_registry.h"
+#include "unix_socket.h"
 
 using namespace std::string_literals;
 using namespace std::literals::string_view_literals;
 
+// Counting global allocator for the allocation budget tests.
+namespace {
+std::atomic<size_t> allocation_count{0};
+
+void *CountedAlloc(std::size_t size, std::size_t alignment) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  size = size ? size : 1;
+  void *result = alignment <= alignof(std::max_align_t)
+                     ? std::malloc(size)
+                     : std::aligned_alloc(alignment, (size + alignment - 1) /
+                                                         alignment * alignment);
+  if (!result) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+} // namespace
+
+void *operator new(std::size_t size) { return CountedAlloc(size, 0); }
+void *operator new[](std::size_t size) { return CountedAlloc(size, 0); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
 namespace my {
 namespace project {
 namespace {
@@ -143,6 +208,1041 @@ TEST(TabulatorTests, GetRowLine) {
   EXPECT_EQ(row_line, result);
 }
 
+TEST(TabulatorTests, AppendRowLineAdjustsAndFills) {
+  tab::TableSchema desc = {{5, "Name"s, tab::Adjust::Left},
+                           {3, "Identifier"s, tab::Adjust::Right}};
+  std::string out = "x"s;
+  const std::array<std::string_view, 2> row = {"AB"sv, "1234"sv};
+  tab::AppendRowLine(out, desc, row);
+  EXPECT_EQ(out, "x|AB   |###|"s);
+  EXPECT_EQ(tab::GetHeaderLine(desc), "| Name|Identifier|"s);
+}
+
+TEST(FormatTests, ValueTextMatchesSoftParameters) {
+  for (auto value : {"0"sv, "1"sv, "29"sv, "255"sv, "256"sv, "x"sv, ""sv}) {
+    sft::ValueText bit(sft::ValueKind::Bit, value);
+    sft::BitSoftParameter bit_param(value);
+    EXPECT_EQ(bit.GetShortValue(), bit_param.GetShortValue());
+    EXPECT_EQ(bit.GetLongValue(), bit_param.GetLongValue());
+
+    sft::ValueText byte(sft::ValueKind::Byte, value);
+    sft::ByteSoftParameter byte_param(value);
+    EXPECT_EQ(byte.GetShortValue(), byte_param.GetShortValue());
+    EXPECT_EQ(byte.GetLongValue(), byte_param.GetLongValue());
+
+    sft::ValueText dword(sft::ValueKind::Dword, value);
+    sft::DwordSoftParameter dword_param(value);
+    EXPECT_EQ(dword.GetShortValue(), dword_param.GetShortValue());
+    EXPECT_EQ(dword.GetLongValue(), dword_param.GetLongValue());
+  }
+  sft::ValueText text(sft::ValueKind::String, "abc"sv);
+  EXPECT_EQ(text.GetLongValue(), "abc"sv);
+}
+
+std::string WriteTempFile(const std::string &name, const std::string &content) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream out(path, std::ios::binary);
+  out << content;
+  return path.string();
+}
+
+TEST(FormatTests, ParameterValueKeepsParsedNumber) {
+  static_assert(std::has_virtual_destructor_v<sft::SoftParameter>);
+  static_assert(std::is_trivially_copyable_v<sft::ParameterValue>);
+
+  sft::ParameterValue byte(sft::ValueKind::Byte, "300"sv);
+  EXPECT_EQ(byte.GetNumber(), 0u);
+  EXPECT_EQ(byte.GetText(), ""sv);
+  sft::ParameterValue bit(sft::ValueKind::Bit, "3"sv);
+  EXPECT_EQ(bit.GetNumber(), 1u);
+  sft::ParameterValue text(sft::ValueKind::String, "abc"sv);
+  EXPECT_EQ(text.GetNumber(), 0u);
+  EXPECT_EQ(text.GetText(), "abc"sv);
+
+  sft::VectorParameterInfo left = {{"DWORD"s, 1, "4294967295"s},
+                                   {"STRING"s, 2, "a"s}};
+  sft::VectorParameterInfo right = {{"DWORD"s, 1, "7"s},
+                                    {"STRING"s, 2, "b"s}};
+  sft::ValueKindMap kinds = {{"DWORD"s, sft::ValueKind::Dword},
+                             {"STRING"s, sft::ValueKind::String}};
+  auto records =
+      sft::MakeDifferences(sft::GetDifferentParameters(left, right), kinds);
+  ASSERT_EQ(records.size(), 2u);
+  for (const auto &record : records) {
+    const sft::ParameterInfo *infos[] = {record.left_, record.right_};
+    for (size_t side = 0; side != 2; ++side) {
+      sft::ValueText stored(record.GetValue(side));
+      sft::ValueText parsed(record.kind_, infos[side]->value_);
+      EXPECT_EQ(stored.GetShortValue(), parsed.GetShortValue());
+      EXPECT_EQ(stored.GetLongValue(), parsed.GetLongValue());
+    }
+  }
+  EXPECT_EQ(records[0].left_number_, 0xffffffffu);
+  EXPECT_EQ(records[0].right_number_, 7u);
+}
+
+TEST(LoadedFile, RecordsPointIntoFile) {
+  auto file = WriteTempFile(
+      "soft_params_loaded_file.txt",
+      "#comment\n"
+      "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=\"1\";\r\n"
+      "SET SYS:NM=\"USN01\";\n"
+      "SET SOFTPARA: DT=BYTE, BYTENUM=7, BYTEVALUE=\"30\";");
+  mml::LoadedFile loaded(file, "SET SOFTPARA:"sv);
+  auto loaded_records = loaded.GetRecords("SET SOFTPARA:"sv);
+  const auto &records = loaded_records.data_;
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(mml::GetItemByKey(records[0], "DT"sv), "BIT"sv);
+  EXPECT_EQ(mml::GetItemByKey(records[0], "BITVALUE"sv), "1"sv);
+  EXPECT_EQ(mml::GetItemByKey(records[1], "BYTENUM"sv), "7"sv);
+  EXPECT_EQ(mml::GetItemByKey(records[1], "NONE"sv), ""sv);
+
+  auto data = loaded.GetData();
+  auto value = mml::GetItemByKey(records[1], "BYTEVALUE"sv);
+  EXPECT_GE(value.data(), data.data());
+  EXPECT_LE(value.data() + value.size(), data.data() + data.size());
+}
+
+TEST(LoadedFile, RecordsShareOneArena) {
+  auto file = WriteTempFile("soft_params_arena.txt",
+                            "SET SOFTPARA: DT=BIT, BITNUM=1, BITVALUE=0;\n"
+                            "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=1;\n");
+  mml::LoadedFile loaded(file, "SET SOFTPARA:"sv);
+  auto records = loaded.GetRecords("SET SOFTPARA:"sv);
+  ASSERT_EQ(records.data_.size(), 2u);
+  for (const auto &record : records.data_) {
+    EXPECT_EQ(record.data_.get_allocator().resource(), records.arena_.get());
+    EXPECT_EQ(record.data_.size(), 3u);
+  }
+
+  auto moved = std::move(records);
+  EXPECT_EQ(mml::GetItemByKey(moved.data_[1], "BITNUM"sv), "2"sv);
+}
+
+TEST(LoadedFile, IndexSeveralCommandsInOnePass) {
+  std::string text = "SET SYS:NM=\"USN01\";\n"
+                     "SET SOFTPARA: DT=BIT, BITNUM=1, BITVALUE=\"0\";\n"
+                     "ADD CELL: ID=1;\n"
+                     "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=\"1\";";
+  auto index = mml::index_commands(
+      text, {"SET SOFTPARA:"s, "SET SYS:"s, "ADD CELL:"s, "RMV CELL:"s});
+
+  ASSERT_EQ(index.data_.size(), 4u);
+  EXPECT_EQ(index.data_["SET SOFTPARA:"].data_.size(), 2u);
+  EXPECT_EQ(index.data_["RMV CELL:"].data_.size(), 0u);
+  ASSERT_EQ(index.data_["ADD CELL:"].data_.size(), 1u);
+  EXPECT_EQ(mml::get_line_at(text, index.data_["ADD CELL:"].data_[0]),
+            "ADD CELL: ID=1;"sv);
+  EXPECT_EQ(mml::get_line_at(text, index.data_["SET SOFTPARA:"].data_[1]),
+            "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=\"1\";"sv);
+}
+
+TEST(LineScanner, MatchesScalarScan) {
+  std::string text;
+  uint32_t seed = 12345u;
+  const std::string_view pieces[] = {"SET SOFTPARA: DT=BIT;"sv, "SET SYS:"sv,
+                                     "S"sv, "SE"sv, "\n"sv, "\n\n"sv, "x"sv,
+                                     "#SET SOFTPARA:"sv};
+  for (int i = 0; i != 2000; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    text += pieces[(seed >> 16) % std::size(pieces)];
+    for (auto filter : {"SET SOFTPARA:"sv, "SET S"sv, "S"sv, ""sv}) {
+      if (i % 97 == 0 || i == 1999) {
+        EXPECT_EQ(mml::find_line_starts(text, filter),
+                  mml::find_line_starts_scalar(text, filter));
+      }
+    }
+  }
+}
+
+TEST(LineScanner, ShortAndEdgeInputs) {
+  EXPECT_TRUE(mml::find_line_starts(""sv, "SET"sv).empty());
+  EXPECT_TRUE(mml::find_line_starts(""sv, ""sv).empty());
+  EXPECT_EQ(mml::find_line_starts("SET"sv, "SET"sv), std::vector<size_t>{0});
+  EXPECT_TRUE(mml::find_line_starts("SE"sv, "SET"sv).empty());
+  EXPECT_EQ(mml::find_line_starts("a\nSET\nSET"sv, "SET"sv),
+            (std::vector<size_t>{2, 6}));
+
+  auto lines = mml::get_lines_by_prefix(
+      "x\nSET SOFTPARA: A=1;\r\nSET SOFTPARA: B=2;"sv, "SET SOFTPARA:"sv);
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0], "SET SOFTPARA: A=1;\r"sv);
+  EXPECT_EQ(lines[1], "SET SOFTPARA: B=2;"sv);
+}
+
+TEST(Tokenizer, KeepsQuotedDelimiters) {
+  auto m = mml::get_map_from_line(
+      " DT=STRING, STRINGNUM=3, STRINGVALUE=\"a,b=c; d\", EMPTY=;\r\n"sv,
+      ',');
+  mml::MapStringString required = {{{"DT"s, "STRING"s},
+                                     {"STRINGNUM"s, "3"s},
+                                     {"STRINGVALUE"s, "a,b=c; d"s},
+                                     {"EMPTY"s, ""s}}};
+  EXPECT_EQ(m.data_, required.data_);
+}
+
+TEST(Tokenizer, TrimsUnquotedAndSkipsItemsWithoutValue) {
+  std::vector<std::pair<std::string_view, std::string_view>> fields;
+  mml::tokenize_command(
+      "  A = 1 2 , FLAG, B='x y' , C=\"\""sv, mml::kMmlCharClasses,
+      [&fields](auto key, auto value) { fields.emplace_back(key, value); });
+
+  decltype(fields) required = {
+      {"A"sv, "1 2"sv}, {"B"sv, "x y"sv}, {"C"sv, ""sv}};
+  EXPECT_EQ(fields, required);
+}
+
+TEST(Tokenizer, IsConstexpr) {
+  constexpr auto count = []() {
+    size_t n = 0;
+    mml::tokenize_command("A=1, B=\"2,3\";"sv, mml::kMmlCharClasses,
+                          [&n](auto, auto) { ++n; });
+    return n;
+  }();
+  static_assert(count == 2);
+  EXPECT_EQ(count, 2u);
+}
+
+TEST(LoadedFile, ScanCommandsInSmallWindows) {
+  std::string text = "SET SYS:NM=A;\n"
+                     "SET SOFTPARA: DT=BIT, BITNUM=1, BITVALUE=0;\n"
+                     "x\n"
+                     "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=1;";
+  std::vector<std::string> prefixes = {"SET SOFTPARA:"s, "SET SYS:"s};
+  for (size_t window : {1ul, 5ul, 20ul, 1000ul}) {
+    std::vector<std::pair<size_t, std::string_view>> lines;
+    mml::scan_commands(text, prefixes, window,
+                       [&lines](size_t command, std::string_view line) {
+                         lines.emplace_back(command, line);
+                       });
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0].first, 1u);
+    EXPECT_EQ(lines[2].second,
+              "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=1;"sv);
+  }
+}
+
+TEST(LoadedFile, NeNameFromIndex) {
+  auto file = WriteTempFile("soft_params_ne_name.txt",
+                            "SET SOFTPARA: DT=BIT, BITNUM=2, BITVALUE=\"1\";\n"
+                            "SET SYS:NM=\"USN01\";\n");
+  mml::LoadedFile loaded(file, {"SET SOFTPARA:"s, "SET SYS:"s});
+  EXPECT_EQ(mml::GetNeName(loaded, "SET SYS:"sv, "NM"sv), "USN01"s);
+  EXPECT_EQ(loaded.GetRecords("SET SOFTPARA:"sv).data_.size(), 1u);
+}
+
+TEST(LoadedFile, ConvertMatchesMapParser) {
+  auto file = WriteTempFile("soft_params_convert.txt",
+                            "SET SOFTPARA: DT=DWORD, DWORDNUM=3, "
+                            "DWORDVALUE=\"13300\";\n"
+                            "SET SOFTPARA: DT=STRING, STRINGNUM=1, "
+                            "STRINGVALUE=\"abc\";\n");
+  mml::ConvertInfo ci;
+  ci.type_key_ = "DT"s;
+  ci.type_to_number_.data_ = {{"DWORD"s, "DWORDNUM"s},
+                              {"STRING"s, "STRINGNUM"s}};
+  ci.type_to_value_.data_ = {{"DWORD"s, "DWORDVALUE"s},
+                             {"STRING"s, "STRINGVALUE"s}};
+
+  auto prefix = "SET SOFTPARA:"s;
+  auto from_views = sft::Load(file, prefix, ci);
+  auto from_maps = sft::Convert(mml::Load(file, prefix), ci);
+  EXPECT_EQ(from_views, from_maps);
+  ASSERT_EQ(from_views.size(), 2u);
+  EXPECT_EQ(from_views[0].value_, "13300"s);
+}
+
+TEST(MergeJoin, LeftRightAndChanged) {
+  sft::VectorParameterInfo v1 = {{"BIT"s, 1, "0"s},
+                                 {"BIT"s, 2, "0"s},
+                                 {"BIT"s, 3, "1"s},
+                                 {"BYTE"s, 1, "30"s}};
+  sft::VectorParameterInfo v2 = {{"BIT"s, 1, "0"s},
+                                 {"BIT"s, 2, "1"s},
+                                 {"BYTE"s, 1, "30"s},
+                                 {"DWORD"s, 7, "5"s}};
+
+  auto diff = sft::GetDifferentParameters(v1, v2);
+  ASSERT_EQ(diff.size(), 3u);
+  EXPECT_EQ(*diff[0].left_, v1[1]);
+  EXPECT_EQ(*diff[0].right_, v2[1]);
+  EXPECT_EQ(*diff[1].left_, v1[2]);
+  EXPECT_EQ(diff[1].right_, nullptr);
+  EXPECT_EQ(diff[2].left_, nullptr);
+  EXPECT_EQ(*diff[2].right_, v2[3]);
+}
+
+TEST(MergeJoin, EqualTablesAndRepeatedKeys) {
+  sft::VectorParameterInfo v1 = {{"BIT"s, 1, "0"s}, {"BIT"s, 1, "1"s}};
+  sft::VectorParameterInfo v2 = {{"BIT"s, 1, "0"s}};
+
+  EXPECT_TRUE(sft::GetDifferentParameters(v1, v2).empty());
+  EXPECT_TRUE(sft::GetDifferentParameters({}, {}).empty());
+  EXPECT_EQ(sft::GetDifferentParameters(v1, {}).size(), 1u);
+}
+
+sft::VectorParameterInfo MakeParameters(uint32_t seed, size_t count) {
+  const std::string types[] = {"BIT"s, "BYTE"s, "DWORD_EX"s, "STRING"s};
+  sft::VectorParameterInfo result;
+  for (size_t i = 0; i != count; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    result.push_back({types[(seed >> 8) % 4], (seed >> 12) % 50,
+                      std::to_string((seed >> 20) % 3)});
+  }
+  return result;
+}
+
+TEST(ExternalSorter, SpilledRunsMatchStableSort) {
+  auto data = MakeParameters(7u, 500);
+  sft::ExternalSorter sorter(1000);
+  for (const auto &info : data) {
+    sorter.Add(info);
+  }
+  sorter.Finish();
+  EXPECT_GT(sorter.GetRunCount(), 1u);
+
+  sft::VectorParameterInfo sorted;
+  for (sft::ParameterInfo info; sorter.Next(info);) {
+    sorted.push_back(info);
+  }
+  sft::SortByKey(data);
+  EXPECT_EQ(sorted, data);
+}
+
+TEST(ExternalSorter, MergesInPassesOfLimitedWidth) {
+  auto data = MakeParameters(9u, 2000);
+  sft::ExternalSorter sorter(300, 3);
+  size_t max_runs = 0;
+  for (const auto &info : data) {
+    sorter.Add(info);
+    max_runs = std::max(max_runs, sorter.GetRunCount());
+  }
+  // hundreds of spills, at most two runs for each of a few levels
+  EXPECT_LE(max_runs, 2u * 8u);
+  sorter.Finish();
+  EXPECT_LE(sorter.GetRunCount(), 3u);
+
+  sft::VectorParameterInfo sorted;
+  for (sft::ParameterInfo info; sorter.Next(info);) {
+    sorted.push_back(info);
+  }
+  sft::SortByKey(data);
+  EXPECT_EQ(sorted, data);
+}
+
+TEST(ExternalSorter, StreamedDifferencesMatchInMemory) {
+  auto v1 = MakeParameters(1u, 300);
+  auto v2 = MakeParameters(2u, 300);
+  sft::ExternalSorter s1(512), s2(1u << 20);
+  for (const auto &info : v1) {
+    s1.Add(info);
+  }
+  for (const auto &info : v2) {
+    s2.Add(info);
+  }
+  s1.Finish();
+  s2.Finish();
+  EXPECT_EQ(s2.GetRunCount(), 0u);
+
+  sft::SortByKey(v1);
+  sft::SortByKey(v2);
+  auto expected = sft::GetDifferentParameters(v1, v2);
+  size_t i = 0;
+  sft::MergeJoin(s1, s2, [&](const sft::ParameterPair &pair) {
+    ASSERT_LT(i, expected.size());
+    EXPECT_EQ(!expected[i].left_, !pair.left_);
+    EXPECT_EQ(!expected[i].right_, !pair.right_);
+    EXPECT_EQ(expected[i].GetInfo(), pair.GetInfo());
+    ++i;
+  });
+  EXPECT_EQ(i, expected.size());
+}
+
+TEST(ExternalSorter, FullyDifferentDumpsStreamInPrintOrder) {
+  auto v1 = MakeParameters(5u, 2000);
+  auto v2 = v1;
+  for (auto &info : v2) {
+    info.value_ += "0"s;
+  }
+  sft::ExternalSorter s1(512, 4, sft::ComparePrintOrder);
+  sft::ExternalSorter s2(512, 4, sft::ComparePrintOrder);
+  for (size_t i = 0; i != v1.size(); ++i) {
+    s1.Add(v1[i]);
+    s2.Add(v2[i]);
+  }
+  s1.Finish();
+  s2.Finish();
+  EXPECT_GT(s1.GetRunCount(), 1u);
+
+  // every key differs, the pairs come one at a time in print order
+  sft::SortByKey(v1);
+  v1.erase(std::unique(v1.begin(), v1.end(),
+                       [](const auto &a, const auto &b) {
+                         return sft::CompareKeys(a, b) == 0;
+                       }),
+           v1.end());
+  std::optional<sft::ParameterInfo> last;
+  size_t count = 0;
+  sft::MergeJoin(s1, s2, [&](const sft::ParameterPair &pair) {
+    ASSERT_TRUE(pair.left_ && pair.right_);
+    EXPECT_EQ(pair.left_->value_ + "0"s, pair.right_->value_);
+    if (last) {
+      EXPECT_LT(sft::ComparePrintOrder(*last, *pair.left_), 0);
+    }
+    last = *pair.left_;
+    ++count;
+  });
+  EXPECT_EQ(count, v1.size());
+}
+
+TEST(Fingerprint, SkipsEqualSectionsWithSameResult) {
+  auto v1 = MakeParameters(11u, 400);
+  auto v2 = v1;
+  v2.push_back({"BYTE"s, 1000, "1"s});
+  v2.push_back({"BIT"s, 3, "2"s});
+  v2.push_back({"WORD"s, 1, "2"s});
+  auto f1 = sft::SortTable(v1);
+  auto f2 = sft::SortTable(v2);
+
+  EXPECT_NE(f1.hash_, f2.hash_);
+  EXPECT_EQ(f1.types_.size(), 4u);
+  EXPECT_EQ(f2.types_.size(), 5u);
+  EXPECT_EQ(f1.types_[2].hash_, f2.types_[2].hash_);
+  EXPECT_EQ(sft::GetFingerprint(v2).hash_, f2.hash_);
+
+  auto plain = sft::GetDifferentParameters(v1, v2);
+  auto skipped = sft::GetDifferentParameters(v1, f1, v2, f2);
+  ASSERT_EQ(plain.size(), skipped.size());
+  for (size_t i = 0; i != plain.size(); ++i) {
+    EXPECT_EQ(plain[i].left_, skipped[i].left_);
+    EXPECT_EQ(plain[i].right_, skipped[i].right_);
+  }
+  EXPECT_TRUE(sft::GetDifferentParameters(v1, f1, v1, f1).empty());
+}
+
+TEST(Fingerprint, SortTableKeepsFirstOfRepeatedKeys) {
+  sft::VectorParameterInfo v = {
+      {"BIT"s, 2, "1"s}, {"BIT"s, 1, "0"s}, {"BIT"s, 2, "0"s}};
+  sft::KeysVector repeated;
+  auto f = sft::SortTable(v, &repeated);
+  EXPECT_EQ(repeated, (sft::KeysVector{{"BIT"s, 2}}));
+  sft::VectorParameterInfo required = {{"BIT"s, 1, "0"s}, {"BIT"s, 2, "1"s}};
+  EXPECT_EQ(v, required);
+  ASSERT_EQ(f.types_.size(), 1u);
+  EXPECT_EQ(f.types_[0].end_, 2u);
+}
+
+TEST(Snapshot, RoundTripAndInvalidation) {
+  auto data = MakeParameters(3u, 100);
+  sft::SortByKey(data);
+  auto path =
+      (std::filesystem::temp_directory_path() / "soft_params_test.snap")
+          .string();
+  sft::SourceStamp stamp{1234, 42, 0xabcdefull};
+  sft::WriteSnapshot(path, stamp, 7, data, "USN01"sv);
+
+  auto snapshot = sft::ReadSnapshot(path, stamp, 7);
+  ASSERT_TRUE(snapshot);
+  EXPECT_EQ(snapshot->data_, data);
+  EXPECT_EQ(snapshot->ne_, "USN01"s);
+
+  auto changed = stamp;
+  changed.hash_ ^= 1;
+  EXPECT_FALSE(sft::ReadSnapshot(path, changed, 7));
+  EXPECT_FALSE(sft::ReadSnapshot(path, stamp, 8));
+  EXPECT_FALSE(sft::ReadSnapshot(path + ".missing"s, stamp, 7));
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_FALSE(sft::ReadSnapshot(path, stamp, 7));
+}
+
+std::string DwordLine(std::string_view id, uint32_t value) {
+  return "SET SOFTPARA: DT=DWORD, DWORDNUM="s + std::string(id) +
+         ", DWORDVALUE="s + std::to_string(value) + ";\n"s;
+}
+
+// Updates the table from content and checks it against a full load.
+const sft::KeysVector &UpdateFromText(sft::IncrementalTable &table,
+                                      const std::string &content) {
+  auto prefix = "SET SOFTPARA:"s;
+  auto path = WriteTempFile("soft_params_incremental.txt", content);
+  mml::LoadedFile file(path, prefix);
+  const auto &changed = table.Update(file);
+
+  auto required = sft::Load(file, prefix, sft::GetConvertInfo("DT"s));
+  auto fingerprint = sft::SortTable(required);
+  EXPECT_EQ(table.GetData(), required);
+  EXPECT_EQ(table.GetFingerprint().hash_, fingerprint.hash_);
+  return changed;
+}
+
+TEST(IncrementalTable, UpdatesMatchFullLoad) {
+  using Keys = sft::KeysVector;
+  sft::IncrementalTable table("SET SOFTPARA:"s, sft::GetConvertInfo("DT"s));
+  std::string lines;
+  for (uint32_t id = 1; id != 7; ++id) {
+    lines += DwordLine(std::to_string(id), id * 10);
+  }
+  EXPECT_EQ(UpdateFromText(table, lines).size(), 6u);
+  EXPECT_EQ(table.GetParsedLineCount(), 6u);
+
+  // modified value
+  std::string modified = lines;
+  modified.replace(modified.find(DwordLine("3", 30)), DwordLine("3", 30).size(),
+                   DwordLine("3", 33));
+  EXPECT_EQ(UpdateFromText(table, modified), (Keys{{"DWORD"s, 3}}));
+  EXPECT_EQ(table.GetParsedLineCount(), 1u);
+
+  // added and removed keys
+  std::string added = modified.substr(DwordLine("1", 10).size());
+  added += DwordLine("7", 70);
+  EXPECT_EQ(UpdateFromText(table, added),
+            (Keys{{"DWORD"s, 1}, {"DWORD"s, 7}}));
+  EXPECT_EQ(table.GetParsedLineCount(), 1u);
+
+  // a repeated key keeps the value of its first line
+  std::string repeated = added + DwordLine("2", 22);
+  EXPECT_TRUE(UpdateFromText(table, repeated).empty());
+  std::string reordered = DwordLine("2", 22) + added;
+  EXPECT_EQ(UpdateFromText(table, reordered), (Keys{{"DWORD"s, 2}}));
+  EXPECT_EQ(table.GetParsedLineCount(), 1u);
+  EXPECT_EQ(UpdateFromText(table, added), (Keys{{"DWORD"s, 2}}));
+
+  // nothing new to parse
+  EXPECT_TRUE(UpdateFromText(table, added).empty());
+  EXPECT_EQ(table.GetParsedLineCount(), 0u);
+}
+
+TEST(IncrementalTable, FailedUpdateKeepsTable) {
+  sft::IncrementalTable table("SET SOFTPARA:"s, sft::GetConvertInfo("DT"s));
+  std::string lines = DwordLine("1", 10) + DwordLine("2", 20);
+  UpdateFromText(table, lines);
+  auto data = table.GetData();
+
+  auto path = WriteTempFile("soft_params_incremental.txt",
+                            lines + DwordLine("x", 30));
+  EXPECT_THROW(table.Update(mml::LoadedFile(path, "SET SOFTPARA:"sv)),
+               std::invalid_argument);
+  EXPECT_EQ(table.GetData(), data);
+  EXPECT_EQ(UpdateFromText(table, lines + DwordLine("3", 30)),
+            (sft::KeysVector{{"DWORD"s, 3}}));
+}
+
+TEST(IncrementalTable, DifferencesOfChangedKeys) {
+  auto v1 = MakeParameters(5u, 300);
+  auto v2 = MakeParameters(6u, 300);
+  sft::SortTable(v1);
+  sft::SortTable(v2);
+  auto keys = sft::CreateCommonIndex(v1, v2);
+  keys.push_back({"MISSING"s, 1});
+
+  auto all = sft::GetDifferentParameters(v1, v2);
+  auto limited = sft::GetDifferentParameters(v1, v2, keys);
+  ASSERT_EQ(limited.size(), all.size());
+  for (size_t i = 0; i != all.size(); ++i) {
+    EXPECT_EQ(limited[i].left_, all[i].left_);
+    EXPECT_EQ(limited[i].right_, all[i].right_);
+  }
+  EXPECT_EQ(sft::FindParameter(v1, {"MISSING"s, 1}), nullptr);
+  EXPECT_EQ(sft::FindParameter(v1, {v1.back().type_, v1.back().id_}),
+            &v1.back());
+}
+
+TEST(FileWatcher, WritesAndRenamesAreReported) {
+  auto first = WriteTempFile("soft_params_watch1.txt", "a");
+  auto second = WriteTempFile("soft_params_watch2.txt", "b");
+  util::FileWatcher watcher({first, second});
+
+  WriteTempFile("soft_params_watch2.txt", "bb");
+  EXPECT_EQ(watcher.Wait(std::chrono::milliseconds(10)),
+            std::vector<size_t>{1});
+
+  auto replacement = WriteTempFile("soft_params_watch1.tmp", "aa");
+  std::filesystem::rename(replacement, first);
+  WriteTempFile("soft_params_watch2.txt", "bbb");
+  EXPECT_EQ(watcher.Wait(std::chrono::milliseconds(10)),
+            (std::vector<size_t>{0, 1}));
+}
+
+TEST(UnixSocket, RequestLinesAndResponse) {
+  const std::chrono::seconds kWait(5);
+  auto path = (std::filesystem::temp_directory_path() / "soft_params.sock")
+                  .string();
+  util::UnixListener listener(path);
+  auto client = std::make_unique<util::SocketStreamBuf>(
+      util::ConnectUnixSocket(path));
+  util::SocketStreamBuf server(listener.Accept());
+
+  std::ostream request(client.get());
+  request << "gold csv dump.txt\nrest" << std::flush;
+  std::string line;
+  ASSERT_EQ(server.ReadLine(line, kWait), util::ReadStatus::Line);
+  EXPECT_EQ(line, "gold csv dump.txt"s);
+
+  std::ostream response(&server);
+  response << "OK\n" << std::string(100, 'x') << "\n";
+  server.ShutdownWrite();
+  ASSERT_EQ(client->ReadLine(line, kWait), util::ReadStatus::Line);
+  EXPECT_EQ(line, "OK"s);
+  ASSERT_EQ(client->ReadLine(line, kWait), util::ReadStatus::Line);
+  EXPECT_EQ(line.size(), 100u);
+  EXPECT_EQ(client->ReadLine(line, kWait), util::ReadStatus::Closed);
+
+  // a closed peer fails the stream instead of raising SIGPIPE
+  client.reset();
+  EXPECT_EQ(server.ReadLine(line, kWait), util::ReadStatus::Closed);
+  std::ostream late(&server);
+  late << std::string(1 << 20, 'y') << std::flush;
+  EXPECT_TRUE(late.fail());
+}
+
+TEST(UnixSocket, ReadLineTimesOut) {
+  const std::chrono::milliseconds kWait(20);
+  auto path = (std::filesystem::temp_directory_path() / "soft_params.sock")
+                  .string();
+  util::UnixListener listener(path);
+  util::SocketStreamBuf client(util::ConnectUnixSocket(path));
+  util::SocketStreamBuf server(listener.Accept());
+
+  std::string line;
+  EXPECT_EQ(server.ReadLine(line, kWait), util::ReadStatus::Timeout);
+  std::ostream request(&client);
+  request << "gold " << std::flush;
+  EXPECT_EQ(server.ReadLine(line, kWait), util::ReadStatus::Timeout);
+  request << "csv dump.txt\n" << std::flush;
+  ASSERT_EQ(server.ReadLine(line, kWait), util::ReadStatus::Line);
+  EXPECT_EQ(line, "gold csv dump.txt"s);
+
+  // a client that doesn't read fails the stream instead of blocking
+  server.SetSendTimeout(kWait);
+  std::ostream response(&server);
+  response << std::string(16 << 20, 'y') << std::flush;
+  EXPECT_TRUE(response.fail());
+}
+
+TEST(UnixSocket, ListenerKeepsPathsInUse) {
+  auto path = WriteTempFile("soft_params.sock", "not a socket");
+  EXPECT_THROW(util::UnixListener listener(path), std::runtime_error);
+  EXPECT_TRUE(std::filesystem::is_regular_file(path));
+  std::filesystem::remove(path);
+
+  util::UnixListener listener(path);
+  EXPECT_THROW(util::UnixListener second(path), std::runtime_error);
+  util::SocketStreamBuf client(util::ConnectUnixSocket(path));
+  util::SocketStreamBuf server(listener.Accept());
+}
+
+TEST(UnixSocket, WakeBeforeAcceptIsNotLost) {
+  auto path = (std::filesystem::temp_directory_path() / "soft_params.sock")
+                  .string();
+  util::UnixListener listener(path);
+  listener.Wake();
+  EXPECT_EQ(listener.Accept(), -1);
+  EXPECT_EQ(listener.Accept(), -1);
+}
+
+TEST(ThreadPool, FuturesKeepSubmitOrder) {
+  util::ThreadPool pool(4);
+  std::vector<std::future<int>> results;
+  for (int i = 0; i != 100; ++i) {
+    results.emplace_back(pool.Async([i]() { return i * i; }));
+  }
+  for (int i = 0; i != 100; ++i) {
+    EXPECT_EQ(results[i].get(), i * i);
+  }
+}
+
+TEST(ThreadPool, NestedTasksAndWait) {
+  util::ThreadPool pool(3);
+  std::atomic<int> counter = 0;
+  for (int i = 0; i != 10; ++i) {
+    pool.Submit([&pool, &counter]() {
+      for (int j = 0; j != 10; ++j) {
+        pool.Submit([&counter]() { ++counter; });
+      }
+    });
+  }
+  pool.Wait();
+  EXPECT_EQ(counter, 100);
+
+  auto failed = pool.Async([]() -> int { throw std::runtime_error("x"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(DifferenceRecord, MatchesDifferenceClasses) {
+  sft::VectorParameterInfo left = {{"BYTE"s, 1, "255"s},
+                                   {"DWORD"s, 2, "7"s},
+                                   {"STRING"s, 3, "a"s},
+                                   {"UNKNOWN"s, 4, "1"s}};
+  sft::VectorParameterInfo right = {{"BIT"s, 0, "1"s},
+                                    {"BYTE"s, 1, "63"s},
+                                    {"DWORD"s, 2, "x"s},
+                                    {"STRING"s, 3, "b"s},
+                                    {"UNKNOWN"s, 4, "2"s}};
+  sft::ValueKindMap kinds = {{"BIT"s, sft::ValueKind::Bit},
+                             {"BYTE"s, sft::ValueKind::Byte},
+                             {"DWORD"s, sft::ValueKind::Dword},
+                             {"STRING"s, sft::ValueKind::String}};
+  sft::FabricDifferenceMap fabric = {{"BIT"s, sft::CreateBitDifference},
+                                     {"BYTE"s, sft::CreateByteDifference},
+                                     {"DWORD"s, sft::CreateDwordDifference},
+                                     {"STRING"s, sft::CreateStringDifference}};
+
+  auto pairs = sft::GetDifferentParameters(left, right);
+  auto records = sft::MakeDifferences(pairs, kinds);
+  ASSERT_EQ(records.size(), 4u);
+  for (const auto &record : records) {
+    const auto &info = record.GetInfo();
+    sft::DifferenceInfo di{info.type_, info.id_,
+                           record.left_ ? record.left_->value_ : ""s,
+                           record.right_ ? record.right_->value_ : ""s};
+    EXPECT_TRUE(record.IsSignificant());
+    EXPECT_EQ(sft::GetDetails(record),
+              sft::FabricDifference(fabric, di)->GetDetails());
+  }
+  EXPECT_EQ(records[2].mask_, 7u);
+}
+
+TEST(DifferenceRecord, MaskOfEqualNumbers) {
+  EXPECT_EQ(sft::GetDifferenceMask(sft::ValueKind::Bit, "1", "3"), 0u);
+  EXPECT_EQ(sft::GetDifferenceMask(sft::ValueKind::Byte, "256", "0"), 0u);
+  EXPECT_EQ(sft::GetDifferenceMask(sft::ValueKind::String, "a", "a"), 0u);
+  EXPECT_TRUE(sft::GetDetails(sft::ValueKind::Dword, "DWORD", 1, 0).empty());
+}
+
+TEST(DifferenceRecord, AppendDetailsMatchesGetDetails) {
+  std::string out;
+  sft::AppendDetails(out, sft::ValueKind::Dword, "DWORD", 6, 0x80000005u);
+  EXPECT_EQ(out, "BIT1 of DWORD6\nBIT3 of DWORD6\nBIT32 of DWORD6\n"s);
+  EXPECT_EQ(sft::GetDetailCount(sft::ValueKind::Dword, 0x80000005u), 3u);
+  EXPECT_EQ(sft::GetDetailCount(sft::ValueKind::String, 1), 1u);
+
+  sft::ByteDifference bd(sft::DifferenceInfo{"BYTE"s, 2, "1"s, "0"s});
+  EXPECT_EQ(bd.GetMask(), 1u);
+  EXPECT_EQ(bd.GetDetails(), sft::DifferenceDetails{"BIT1 of BYTE2"s});
+}
+
+TEST(XorColumns, MatchesScalarKernel) {
+  uint32_t seed = 777u;
+  std::vector<uint32_t> left32, right32;
+  std::vector<uint8_t> left8, right8;
+  for (size_t n = 0; n != 100; ++n) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t value = (seed >> 8) % 4 ? seed : 0u;
+    left32.emplace_back(seed);
+    right32.emplace_back(seed ^ value);
+    left8.emplace_back(static_cast<uint8_t>(seed >> 3));
+    right8.emplace_back(static_cast<uint8_t>((seed >> 3) ^ (value >> 24)));
+
+    std::vector<uint32_t> out32(n + 1), expected32(n + 1);
+    std::vector<uint8_t> out8(n + 1), expected8(n + 1);
+    EXPECT_EQ(sft::XorColumns(left32, right32, out32),
+              sft::XorColumnsScalar(left32, right32, expected32));
+    EXPECT_EQ(out32, expected32);
+    EXPECT_EQ(sft::XorColumns(left8, right8, out8),
+              sft::XorColumnsScalar(left8, right8, expected8));
+    EXPECT_EQ(out8, expected8);
+  }
+  std::vector<uint8_t> out(1);
+  EXPECT_THROW(sft::XorColumns(left8, right8, out), std::invalid_argument);
+}
+
+TEST(XorColumns, ForEachBitMatchesGetBitsNumbers) {
+  for (uint32_t mask : {0u, 1u, 0x80000001u, 0xffffffffu, 0x1234u}) {
+    std::vector<int> bits;
+    sft::ForEachBit(mask, [&bits](int bit) { bits.emplace_back(bit); });
+    EXPECT_EQ(bits, sft::GetBitsNumbers(mask, 32));
+  }
+}
+
+TEST(ReportSink, NdjsonAndCsvRecords) {
+  sft::VectorParameterInfo left = {{"BYTE"s, 1, "255"s},
+                                   {"STRING"s, 2, "a\"b,c"s}};
+  sft::VectorParameterInfo right = {{"BYTE"s, 1, "63"s}};
+  sft::ValueKindMap kinds = {{"BYTE"s, sft::ValueKind::Byte},
+                             {"STRING"s, sft::ValueKind::String}};
+  auto records =
+      sft::MakeDifferences(sft::GetDifferentParameters(left, right), kinds);
+
+  std::ostringstream json, csv;
+  {
+    sft::BufferedWriter json_writer(json), csv_writer(csv, 16);
+    sft::NdjsonSink json_sink(json_writer);
+    sft::CsvSink csv_sink(csv_writer);
+    std::array<sft::IReportSink *, 2> sinks = {&json_sink, &csv_sink};
+    for (auto *sink : sinks) {
+      sink->Begin();
+      sink->BeginPair("NE\n1", "NE2");
+      for (const auto &record : records) {
+        sink->Add(record);
+      }
+      sink->EndPair();
+    }
+  }
+  EXPECT_EQ(json.str(),
+            "{\"ne1\":\"NE\\u000a1\",\"ne2\":\"NE2\",\"type\":\"BYTE\","
+            "\"id\":1,\"value1\":\"255\",\"value2\":\"63\",\"bits\":[7,8]}\n"
+            "{\"ne1\":\"NE\\u000a1\",\"ne2\":\"NE2\",\"type\":\"STRING\","
+            "\"id\":2,\"value1\":\"a\\\"b,c\",\"value2\":null,\"bits\":[]}\n"s);
+  EXPECT_EQ(csv.str(), "ne1,ne2,type,id,value1,value2,bits\n"
+                       "\"NE\n1\",NE2,BYTE,1,255,63,7 8\n"
+                       "\"NE\n1\",NE2,STRING,2,\"a\"\"b,c\",,\n"s);
+}
+
+TEST(ReportSink, WatchReportsAreNumberedAndShowEmptyOnes) {
+  sft::VectorParameterInfo left = {{"BYTE"s, 1, "255"s}};
+  sft::VectorParameterInfo right = {{"BYTE"s, 1, "63"s}};
+  sft::ValueKindMap kinds = {{"BYTE"s, sft::ValueKind::Byte}};
+  auto records =
+      sft::MakeDifferences(sft::GetDifferentParameters(left, right), kinds);
+
+  // the second version made the files equal
+  std::ostringstream out;
+  {
+    sft::BufferedWriter writer(out);
+    sft::CsvSink sink(writer);
+    sft::WriteWatchReport(writer, sink, 1, "10:00:00"sv, "NE1", "NE2",
+                          records);
+    sft::WriteWatchReport(writer, sink, 2, "10:00:05"sv, "NE1", "NE2", {});
+  }
+  EXPECT_EQ(out.str(), "=== Report 1 at 10:00:00: 1 difference ===\n"
+                       "NE1,NE2,BYTE,1,255,63,7 8\n"
+                       "=== Report 2 at 10:00:05: no differences ===\n"s);
+}
+
+TEST(Stats, SumsByNameInFirstSeenOrder) {
+  util::Stats stats;
+  stats.Add("records"sv, 2);
+  stats.AddTime("parse"sv, std::chrono::milliseconds(2));
+  stats.Add("bytes"sv, 10);
+  stats.Add("records"sv, 3);
+  stats.AddTime("parse"sv, std::chrono::milliseconds(1));
+  {
+    util::StageTimer timer(nullptr, "ignored"sv);
+  }
+
+  std::ostringstream text, json;
+  stats.Print(text);
+  stats.PrintJson(json);
+  EXPECT_EQ(text.str(), "parse: 3 ms\nrecords: 5\nbytes: 10\n"s);
+  EXPECT_EQ(json.str(), "{\"stages_ms\":{\"parse\":3},"
+                        "\"counters\":{\"records\":5,\"bytes\":10}}\n"s);
+}
+
+TEST(Stats, MergeSuffixesTimesAndSumsCounters) {
+  util::Stats stats, worker;
+  stats.AddTime("parse"sv, std::chrono::milliseconds(1));
+  stats.Add("records"sv, 2);
+  worker.AddTime("parse"sv, std::chrono::milliseconds(4));
+  worker.Add("records"sv, 3);
+  stats.Merge(worker, "_cpu"sv);
+
+  std::ostringstream text;
+  stats.Print(text);
+  EXPECT_EQ(text.str(), "parse: 1 ms\nparse_cpu: 4 ms\nrecords: 5\n"s);
+}
+
+TEST(Stats, CountCommonKeysAndWrittenBytes) {
+  sft::VectorParameterInfo v1 = {{"BIT"s, 1, "0"s},
+                                 {"BIT"s, 1, "1"s},
+                                 {"BIT"s, 3, "1"s},
+                                 {"BYTE"s, 2, "7"s}};
+  sft::VectorParameterInfo v2 = {
+      {"BIT"s, 1, "0"s}, {"BIT"s, 2, "0"s}, {"DWORD"s, 1, "5"s}};
+  EXPECT_EQ(sft::CountCommonKeys(v1, v2),
+            sft::CreateCommonIndex(v1, v2).size());
+  EXPECT_EQ(sft::CountCommonKeys(v1, {}), 3u);
+  EXPECT_EQ(sft::CountCommonKeys({}, {}), 0u);
+
+  std::ostringstream out;
+  sft::BufferedWriter writer(out, 4);
+  writer.GetBuffer().append("abcdef");
+  writer.Commit();
+  writer.GetBuffer().append("gh");
+  EXPECT_EQ(writer.GetWrittenBytes(), 6u);
+  writer.Flush();
+  EXPECT_EQ(writer.GetWrittenBytes(), 8u);
+}
+
+TEST(TypeRegistry, PerfectHashFindsEveryType) {
+  for (size_t i = 0; i != sft::kTypeRegistry.size(); ++i) {
+    const sft::TypeDescriptor &type = sft::kTypeRegistry[i];
+    EXPECT_EQ(sft::FindTypeCode(type.name_), i);
+    EXPECT_EQ(sft::FindType(type.name_), &type);
+    EXPECT_EQ(sft::FindValueKind(type.name_), type.kind_);
+    EXPECT_EQ(type.print_rank_, i + 1);
+  }
+  for (auto name : {"bit"sv, "BIT_"sv, "BIT_EX_C"sv, "STRINGS"sv, ""sv}) {
+    EXPECT_EQ(sft::FindTypeCode(name), sft::kUnknownType);
+    EXPECT_EQ(sft::FindValueKind(name), std::nullopt);
+  }
+  static_assert(sft::FindType("DWORD_EX")->value_width_ == 32);
+
+  mml::ConvertInfo ci = sft::GetConvertInfo("DT"s);
+  EXPECT_EQ(ci.type_to_number_.data_.at("BYTE_EX_B"s), "BYTENUM"s);
+  EXPECT_EQ(ci.type_to_value_.data_.at("STRING_EX"s), "STRINGVALUE"s);
+  EXPECT_EQ(sft::GetFabricMap().at("DWORD"s),
+            sft::CreateDwordSoftParameter);
+}
+
+TEST(TypeRegistry, MakeDifferencesWithLookup) {
+  sft::VectorParameterInfo left = {{"BIT"s, 1, "0"s},
+                                   {"BYTE_EX"s, 2, "255"s},
+                                   {"OTHER"s, 3, "1"s}};
+  sft::VectorParameterInfo right = {{"BIT"s, 1, "1"s},
+                                    {"BYTE_EX"s, 2, "1"s},
+                                    {"OTHER"s, 3, "2"s}};
+  auto pairs = sft::GetDifferentParameters(left, right);
+  auto from_map = sft::MakeDifferences(pairs, sft::GetValueKindMap());
+  auto from_lookup = sft::MakeDifferences(pairs, sft::FindValueKind);
+  ASSERT_EQ(from_lookup.size(), 2u);
+  for (size_t i = 0; i != from_lookup.size(); ++i) {
+    EXPECT_EQ(from_lookup[i].kind_, from_map[i].kind_);
+    EXPECT_EQ(from_lookup[i].mask_, from_map[i].mask_);
+  }
+  EXPECT_EQ(from_lookup[1].mask_, 0xfeu);
+}
+
+// Allocations made since construction.
+class AllocationCounter {
+public:
+  size_t GetCount() const { return allocation_count.load() - start_; }
+
+private:
+  size_t start_ = allocation_count.load();
+};
+
+// A dump of every value kind where each second record of the second table
+// differs, with values too long for the small string buffer.
+std::array<std::string, 2> WriteBudgetDumps(size_t records) {
+  const std::array<std::string, 4> types = {"BIT"s, "BYTE"s, "DWORD"s,
+                                            "STRING"s};
+  std::array<std::string, 2> text;
+  for (size_t i = 0; i != records; ++i) {
+    const std::string &type = types[i % types.size()];
+    for (size_t side = 0; side != 2; ++side) {
+      size_t value = side && i % 2 ? i + 1 : i;
+      std::string field = type == "STRING"s
+                              ? "long_string_value_"s + std::to_string(value)
+                              : std::to_string(value % 2);
+      text[side] += "SET SOFTPARA: DT="s + type + ", "s + type + "NUM="s +
+                    std::to_string(i) + ", "s + type + "VALUE=\""s + field +
+                    "\";\n"s;
+    }
+  }
+  return {WriteTempFile("soft_params_budget1.txt", text[0]),
+          WriteTempFile("soft_params_budget2.txt", text[1])};
+}
+
+mml::ConvertInfo GetBudgetConvertInfo() {
+  mml::ConvertInfo ci;
+  ci.type_key_ = "DT"s;
+  for (const auto &type : {"BIT"s, "BYTE"s, "DWORD"s, "STRING"s}) {
+    ci.type_to_number_.data_[type] = type + "NUM"s;
+    ci.type_to_value_.data_[type] = type + "VALUE"s;
+  }
+  return ci;
+}
+
+const size_t kBudgetRecords = 4000;
+// vector growth, the index, the arena and other allocations per call
+const size_t kFixedAllocations = 200;
+
+// Allocations per parsed record: the map nodes of three fields and the
+// key and value strings that don't fit the small string buffer.
+const size_t kMmlLoadBudget = 6;
+// Only values longer than the small string buffer are allocated.
+const size_t kConvertBudget = 1;
+
+TEST(AllocationBudget, MmlLoad) {
+  auto files = WriteBudgetDumps(kBudgetRecords);
+  AllocationCounter counter;
+  auto result = mml::Load(files[0], "SET SOFTPARA:"s);
+  size_t count = counter.GetCount();
+  ASSERT_EQ(result.data_.size(), kBudgetRecords);
+  EXPECT_LE(count, kMmlLoadBudget * kBudgetRecords + kFixedAllocations);
+}
+
+TEST(AllocationBudget, Convert) {
+  auto files = WriteBudgetDumps(kBudgetRecords);
+  mml::LoadedFile file(files[0], "SET SOFTPARA:"sv);
+  auto records = file.GetRecords("SET SOFTPARA:"sv);
+  const mml::ConvertInfo ci = GetBudgetConvertInfo();
+  AllocationCounter counter;
+  auto result = sft::Convert(records, ci);
+  size_t count = counter.GetCount();
+  ASSERT_EQ(result.size(), kBudgetRecords);
+  EXPECT_LE(count, kConvertBudget * kBudgetRecords + kFixedAllocations);
+
+  // the whole path of the program: mapping, index, records and conversion
+  AllocationCounter load_counter;
+  auto loaded = sft::Load(files[0], "SET SOFTPARA:"s, ci);
+  EXPECT_LE(load_counter.GetCount(),
+            kConvertBudget * kBudgetRecords + kFixedAllocations);
+}
+
+TEST(AllocationBudget, CompareLoop) {
+  auto files = WriteBudgetDumps(kBudgetRecords);
+  const mml::ConvertInfo ci = GetBudgetConvertInfo();
+  std::array<sft::VectorParameterInfo, 2> tables;
+  std::array<sft::TableFingerprint, 2> fingerprints;
+  for (size_t i = 0; i != 2; ++i) {
+    tables[i] = sft::Load(files[i], "SET SOFTPARA:"s, ci);
+    fingerprints[i] = sft::SortTable(tables[i]);
+  }
+  sft::ValueKindMap kinds = {{"BIT"s, sft::ValueKind::Bit},
+                             {"BYTE"s, sft::ValueKind::Byte},
+                             {"DWORD"s, sft::ValueKind::Dword},
+                             {"STRING"s, sft::ValueKind::String}};
+  std::ostringstream out;
+  out.str(std::string(1 << 20, ' '));
+  const sft::TableInfo table_info = sft::PrepareTableInfo();
+
+  // the difference, its record and its table are built without a single
+  // allocation per difference
+  AllocationCounter counter;
+  auto pairs = sft::GetDifferentParameters(tables[0], fingerprints[0],
+                                           tables[1], fingerprints[1]);
+  auto differences = sft::MakeDifferences(pairs, kinds);
+  {
+    sft::BufferedWriter writer(out);
+    sft::TableSink sink(writer, table_info);
+    sink.BeginPair("NE01"sv, "NE02"sv);
+    for (const auto &record : differences) {
+      sink.Add(record);
+    }
+    sink.EndPair();
+  }
+  size_t count = counter.GetCount();
+  ASSERT_EQ(differences.size(), kBudgetRecords / 2);
+  EXPECT_LE(count, kFixedAllocations);
+}
+
+TEST(AllocationBudget, BorrowingAccessors) {
+  sft::DifferenceInfo di{"BYTE_EX_B"s, 3, "255"s, "0"s};
+  sft::ByteDifference difference(std::move(di));
+  sft::StringSoftParameter parameter("a value longer than the buffer"s);
+  // function-local statics are built on the first call, outside the count
+  const auto &fabric = sft::GetFabricDifferenceMap();
+  const auto &kinds = sft::GetValueKindMap();
+  auto details = difference.GetDetailsView();
+  auto data = parameter.GetDataView();
+
+  AllocationCounter counter;
+  EXPECT_EQ(difference.GetDetailsView().data(), details.data());
+  EXPECT_EQ(parameter.GetDataView(), data);
+  EXPECT_EQ(&sft::GetFabricDifferenceMap(), &fabric);
+  EXPECT_EQ(&sft::GetValueKindMap(), &kinds);
+  EXPECT_EQ(counter.GetCount(), 0u);
+
+  EXPECT_EQ(details.size(), 8u);
+  EXPECT_EQ(difference.GetDetails(),
+            sft::DifferenceDetails(details.begin(), details.end()));
+  EXPECT_EQ(data, "a value longer than the buffer"sv);
+  EXPECT_EQ(parameter.GetData(), data);
+  EXPECT_EQ(fabric.at("BYTE_EX_B"s), sft::CreateByteDifference);
+}
+
 TEST(SVtoInt, Uint8) {
   std::string_view test = "255"sv;
   auto val = util::to_int<uint8_t>(test);